@@ -0,0 +1,71 @@
+#ifndef __CODEC_H_
+#define __CODEC_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+// Wire encodings for temperature records.
+// JSON is the human readable default; the binary layout is a fixed little-endian
+// record format with a version header, meant for metered links.
+//
+// Binary layout (all integers little-endian):
+//   header: 'S' 'N' | version u8 | flags u8 | count u16 | id_len u8 | id[id_len]
+//   record: timestamp i64 | temperature f64 | threshold_flag u8   (17 bytes)
+//           [+ min f32 | max f32 | stddev f32 | p95 f32 when CODEC_FLAG_STATS is set, 33 bytes]
+#define CODEC_BIN_MAGIC_0   'S'
+#define CODEC_BIN_MAGIC_1   'N'
+#define CODEC_BIN_VERSION   1
+#define CODEC_BIN_HDR_LEN   7
+#define CODEC_BIN_REC_LEN   17
+#define CODEC_BIN_STATS_LEN 16
+#define CODEC_FLAG_STATS    0x01
+#define CODEC_MAX_BATCH     64
+#define CODEC_DEVICE_ID_MAX 64
+
+#define CODEC_CT_JSON   "application/json"
+#define CODEC_CT_BINARY "application/x-ssn1"
+
+typedef enum
+{
+    CODEC_FORMAT_JSON,
+    CODEC_FORMAT_BINARY,
+    CODEC_FORMAT_UNKNOWN
+} codec_format_t;
+
+typedef struct temp_record temp_record_t;
+
+struct temp_record
+{
+    time_t timestamp;
+    double temperature;
+    int    threshold_flag;
+    // Optional window aggregates, encoded when has_stats is set
+    int    has_stats;
+    float  min;
+    float  max;
+    float  stddev;
+    float  p95;
+};
+
+// Server control section carried in a JSON response body, e.g.
+//   {"control": {"interval": 300, "batch": 10, "retry_after": 60}}
+// Members that are absent are left at -1.
+typedef struct codec_control codec_control_t;
+
+struct codec_control
+{
+    long interval;      // Seconds between routine uploads
+    long batch;         // Averages to collect before an upload
+    long retry_after;   // Seconds to hold routine uploads
+};
+
+int codec_json_encode(char *buf, size_t cap, const char *device_id, const struct temp_record *records, size_t count);
+int codec_bin_encode(uint8_t *buf, size_t cap, const char *device_id, const struct temp_record *records, size_t count);
+int codec_json_decode(const char *buf, size_t len, char *device_id, size_t id_cap, struct temp_record *records, size_t max);
+int codec_bin_decode(const uint8_t *buf, size_t len, char *device_id, size_t id_cap, struct temp_record *records, size_t max);
+codec_format_t codec_format_from_content_type(const char *content_type, size_t len);
+const char *codec_content_type(codec_format_t format);
+int codec_control_decode(const char *body, struct codec_control *control);
+
+#endif /* __CODEC_H_ */
@@ -0,0 +1,12 @@
+#ifndef __CONTAINER_H_
+#define __CONTAINER_H_
+
+#include <stddef.h>
+
+// Container of macro: 
+// This macro computes the address of the structure (type) that contains the member (member),
+// given a pointer to the member (ptr).
+// This is the core of the type-safe, embedded callback pattern.
+#define CONTAINER_OF(ptr, type, member) ((type *)((char *)(ptr) - offsetof(type, member)))
+
+#endif /* __CONTAINER_H_ */
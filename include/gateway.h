@@ -0,0 +1,110 @@
+#ifndef __GATEWAY_H_
+#define __GATEWAY_H_
+
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include "ring.h"
+
+// Sharded gateway: the nodes are split across N shards, each running its own event loop on a
+// thread pinned to one core. A shard owns its nodes, virtual clock and loopback receiver outright,
+// so nothing mutable is shared on the hot path. In HTTP mode the nodes upload through an in-memory
+// transport to a server inside the shard instead, so spooling, pacing, holds and the retry policy
+// all run on the virtual clock. The coordinating thread talks to a shard only
+// through two SPSC rings: control messages in, cumulative statistics out.
+#define GATEWAY_MAX_SHARDS   64
+#define GATEWAY_RING_SLOTS   64
+#define GATEWAY_STATS_PERIOD 3600   // Virtual seconds between statistics messages
+#define GATEWAY_RX_BATCH     64     // Outstanding datagrams that make a shard drain its receiver mid-step
+#define GATEWAY_RX_WAIT_MS   100    // Longest a shard blocks for its own datagrams before giving up on them
+#define GATEWAY_RETRY_AFTER  60     // Retry-After the in-memory HTTP server sends with a 503
+
+typedef enum
+{
+    GATEWAY_CTL_THRESHOLDS,     // a = low, b = high warning threshold
+    GATEWAY_CTL_REPORT_POLICY,  // a = deadband, b = heartbeat in seconds
+    GATEWAY_CTL_STOP
+} gateway_ctl_type_t;
+
+// Gateway -> shard
+struct gateway_ctl
+{
+    gateway_ctl_type_t type;
+    double a;
+    double b;
+};
+
+// Shard -> gateway. Counters are cumulative, so a message dropped on a full ring loses nothing.
+struct gateway_stats
+{
+    int      shard;
+    int      done;
+    int      log_idx;       // Log index of the shard's first node
+    long     steps;         // Virtual seconds simulated
+    double   busy_s;        // Wall time spent in the loop
+    uint64_t readings;
+    uint64_t cycles;
+    uint64_t alerts;
+    uint64_t sent;
+    uint64_t suppressed;
+    uint64_t received;      // Records decoded by the shard's receiver
+    uint64_t lost;          // Datagrams the receiver saw missing
+    uint64_t requests;      // HTTP mode: requests the server answered
+    uint64_t throttled;     // HTTP mode: requests answered with 503 and Retry-After
+    uint64_t refused;       // HTTP mode: requests failed in transport
+    uint64_t dropped;       // HTTP mode: averages the nodes dropped (spool overflow or rejected)
+};
+
+struct gateway_config
+{
+    int      n_nodes;
+    int      n_shards;
+    long     steps;         // Virtual seconds to run, -1 to run until every source ends
+    time_t   epoch;         // Virtual start time
+    double   low_th;
+    double   high_th;
+    double   deadband;
+    unsigned seed;
+    const char *trace;      // Recording replayed by every node, NULL for simulated sensors
+    int      http;          // Upload over HTTP to the shard's in-memory server instead of UDP
+    double   http_busy;     // Share of requests the server sheds with 503
+    double   http_fail;     // Share of requests that fail in transport
+};
+
+struct gateway;
+
+typedef struct shard shard_t;
+
+struct shard
+{
+    struct gateway *gateway;
+    int id;
+    int cpu;
+    int first_node;
+    int n_nodes;
+    pthread_t thread;
+    struct ring *ctl;       // Gateway -> shard
+    struct ring *stats;     // Shard -> gateway
+};
+
+typedef struct gateway gateway_t;
+
+struct gateway
+{
+    struct gateway_config config;
+    struct shard shards[GATEWAY_MAX_SHARDS];
+    struct gateway_stats latest[GATEWAY_MAX_SHARDS];   // Last message seen from each shard
+    int started;
+};
+
+int gateway_init(struct gateway **self, const struct gateway_config *config);
+int gateway_start(struct gateway *self);
+int gateway_set_thresholds(struct gateway *self, double low, double high);
+int gateway_set_report_policy(struct gateway *self, double deadband, int heartbeat);
+int gateway_stop(struct gateway *self);
+int gateway_poll_stats(struct gateway *self);
+int gateway_join(struct gateway *self);
+void gateway_total(const struct gateway *self, struct gateway_stats *out);
+int gateway_dispose(struct gateway **self);
+
+#endif /* __GATEWAY_H_ */
@@ -5,12 +5,8 @@
 #include <time.h>
 #include <stddef.h>
 #include "tcp.h"
-
-// Container of macro: 
-// This macro computes the address of the structure (type) that contains the member (member),
-// given a pointer to the member (ptr).
-// This is the core of the type-safe, embedded callback pattern.
-#define CONTAINER_OF(ptr, type, member) ((type *)((char *)(ptr) - offsetof(type, member)))
+#include "codec.h"
+#include "container.h"
 
 struct http_cb;
 typedef int (*http_cb_fn)(struct http_cb *self, const char *msg);
@@ -19,6 +15,19 @@ struct http_cb
     http_cb_fn cb_fn;
 };
 
+// Optional Content-Encoding for upload bodies. "deflate" is the zlib-wrapped stream of RFC 9110.
+typedef enum
+{
+    HTTP_ENCODING_IDENTITY,
+    HTTP_ENCODING_DEFLATE,
+    HTTP_ENCODING_GZIP
+} http_encoding_t;
+
+#define HTTP_ENCODE_MIN_DEFAULT 512   // Bodies below this are sent as they are
+#define HTTP_BODY_MAX           16384 // Largest encoded upload body
+
+struct z_stream_s;
+
 typedef enum 
 {
     HTTP_STATE_IDLE,
@@ -27,6 +36,16 @@ typedef enum
     HTTP_STATE_ERROR
 } http_state_t;
 
+// Parsed view of a raw response held in struct http: status code, Retry-After and body.
+typedef struct http_response http_response_t;
+
+struct http_response
+{
+    int status;           // Status code, 0 if the status line could not be parsed
+    long retry_after;     // Retry-After in seconds (delta or HTTP-date), -1 if absent
+    const char *body;     // Points into the raw response, "" if there is none
+};
+
 typedef struct http http_t;
 
 struct http
@@ -35,6 +54,21 @@ struct http
     char *host;
     char *port;
     http_state_t state;   
+    // Body encoding used for uploads, JSON unless http_set_format() selects binary.
+    codec_format_t format;
+    // Reuse one connection for every request (http_set_keep_alive), off by default.
+    int keep_alive;
+    // Body compression (http_set_encoding): one deflate stream per client, reset between requests
+    // instead of set up again. bytes_raw/bytes_encoded count upload bodies before and after it.
+    http_encoding_t encoding;
+    size_t encode_min;
+    struct z_stream_s *zstream;
+    uint64_t bytes_raw;
+    uint64_t bytes_encoded;
+    // Upload bodies are encoded into body and compressed into packed. Both hold HTTP_BODY_MAX bytes and
+    // are allocated once per client (packed while compression is on), keeping uploads off the stack.
+    char *body;
+    char *packed;
     // The HTTP struct now embeds the TCP callback structure.
     // This is the member whose address is passed to tcp_set_callback.
     struct tcp_cb tcp_handle;
@@ -46,7 +80,20 @@ struct http
 
 int http_init(struct http **self, const char *host, const char *port);
 void http_set_callback(struct http *self, struct http_cb *cb_handle, http_cb_fn fn);
+void http_set_format(struct http *self, codec_format_t format);
+void http_set_keep_alive(struct http *self, int enable);
+void http_set_seed(struct http *self, unsigned int seed);
+void http_set_clock(struct http *self, struct tcp_clock *clock);
+void http_set_transport(struct http *self, struct tcp_transport *transport);
+int http_set_encoding(struct http *self, http_encoding_t encoding, size_t min_size, int level);
+int http_deflate(struct http *self, const void *in, size_t in_len, void *out, size_t out_cap);
+size_t http_response_length(const char *data, size_t len);
+int http_ready(struct http *self);
+tcp_link_t http_link_state(const struct http *self);
 int http_send_temp_data(struct http *self, const char *device_id, time_t timestamp, double temperature, int threshold_flag);
+int http_send_temp_batch(struct http *self, const char *device_id, const struct temp_record *records, size_t count);
+int http_parse_response(const char *response, time_t now, struct http_response *out);
+int http_status_transient(int status);
 int http_work(struct http *self);
 int http_dispose(struct http **self);
 
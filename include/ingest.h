@@ -0,0 +1,77 @@
+#ifndef __INGEST_H_
+#define __INGEST_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "codec.h"
+
+// Companion ingest server for SSN-1 uploads. Each worker thread runs its own epoll loop on its own
+// SO_REUSEPORT listener, so the kernel spreads connections and no worker shares mutable state with another.
+// Requests are parsed in place in the receive buffer (JSON or binary, single or batch) and the records
+// are appended to one columnar file per device.
+//
+// Column file (<dir>/<device_id>.col, bytes outside [A-Za-z0-9._-] and a leading dot written as %XX):
+// a sequence of blocks, each written with one writev() on an O_APPEND descriptor so blocks from
+// different workers never interleave:
+//   magic u32 "SSNC" | rows u32 | timestamp i64[rows] | temperature f64[rows]
+//   | min f32[rows] | max f32[rows] | stddev f32[rows] | p95 f32[rows] | threshold_flag u8[rows]
+// Host byte order. The aggregates are NaN for records sent without them. A block that cannot be
+// written completely is cut off again and its rows stay buffered for the next flush.
+#define INGEST_COL_MAGIC     0x434E5353u // "SSNC"
+#define INGEST_BLOCK_ROWS    64
+#define INGEST_MAX_WORKERS   64
+#define INGEST_MAX_EVENTS    256
+#define INGEST_SCRATCH       65536       // Per-worker receive buffer; also the largest accepted request
+#define INGEST_FLUSH_MS      1000        // Partly filled blocks are written out at least this often
+
+struct ingest_col_header
+{
+    uint32_t magic;
+    uint32_t rows;
+};
+
+// Counters published by each worker (relaxed atomics, read by any thread)
+struct ingest_stats
+{
+    uint64_t connections;   // Currently open
+    uint64_t accepted;
+    uint64_t requests;
+    uint64_t records;
+    uint64_t bytes;
+    uint64_t errors;        // Requests answered with an error status, failed block writes
+    uint64_t blocks;        // Column blocks written
+};
+
+struct ingest;
+
+typedef struct ingest_worker ingest_worker_t;
+
+struct ingest_worker
+{
+    _Alignas(64) struct ingest *ingest;
+    int id;
+    int listen_fd;
+    int epfd;
+    pthread_t thread;
+    struct ingest_stats stats;
+};
+
+typedef struct ingest ingest_t;
+
+struct ingest
+{
+    char *dir;
+    unsigned short port;
+    int n_workers;
+    int running;
+    struct ingest_worker workers[INGEST_MAX_WORKERS];
+};
+
+int ingest_init(struct ingest **self, const char *bind_host, const char *port, const char *dir, int n_workers);
+int ingest_start(struct ingest *self);
+void ingest_stats(struct ingest *self, struct ingest_stats *out);
+void ingest_stop(struct ingest *self);
+int ingest_dispose(struct ingest **self);
+
+#endif /* __INGEST_H_ */
@@ -0,0 +1,15 @@
+#ifndef __LOG_H_
+#define __LOG_H_
+
+#include <stdio.h>
+
+// Diagnostic output of the library modules. Every layer logs its progress to stdout;
+// log_set_verbose(0) turns that off for runs where the formatting and the shared stdout
+// lock would dominate (simulation, sharded gateway, load tests).
+extern int log_verbose;
+
+#define LOG(...) do { if (log_verbose) printf(__VA_ARGS__); } while (0)
+
+void log_set_verbose(int verbose);
+
+#endif /* __LOG_H_ */
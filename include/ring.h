@@ -0,0 +1,27 @@
+#ifndef __RING_H_
+#define __RING_H_
+
+#include <stddef.h>
+
+// Lock-free single-producer/single-consumer message ring with fixed-size slots.
+// Producer and consumer indices sit on separate cache lines so the two threads only
+// share a line when a message actually changes hands.
+#define RING_CACHE_LINE 64
+
+typedef struct ring ring_t;
+
+struct ring
+{
+    size_t mask;        // Capacity - 1 (capacity is a power of two)
+    size_t msg_size;
+    unsigned char *slots;
+    _Alignas(RING_CACHE_LINE) size_t head;  // Next slot to pop, written by the consumer
+    _Alignas(RING_CACHE_LINE) size_t tail;  // Next slot to push, written by the producer
+};
+
+int ring_init(struct ring **self, size_t capacity, size_t msg_size);
+int ring_push(struct ring *self, const void *msg);
+int ring_pop(struct ring *self, void *msg);
+int ring_dispose(struct ring **self);
+
+#endif /* __RING_H_ */
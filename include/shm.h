@@ -0,0 +1,61 @@
+#ifndef __SHM_H_
+#define __SHM_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Local publication of a node's latest values through a POSIX shared-memory segment.
+// The writer (ssn1) updates the record under a seqlock: it bumps seq to odd, writes the fields
+// and bumps seq back to even. Readers copy the record and retry if seq was odd or changed,
+// so neither side takes a lock or makes a syscall per update/read.
+#define SHM_MAGIC   0x4D485353u // "SSHM"
+#define SHM_VERSION 1
+#define SHM_NAME_MAX 96
+
+typedef struct shm_record shm_record_t;
+
+struct shm_record
+{
+    int64_t  timestamp;     // Time of the latest reading
+    double   temp_read;
+    double   temp_average;
+    int32_t  th_flag;
+    int32_t  alert_active;
+    uint64_t updates;       // Number of published updates
+};
+
+struct shm_segment
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t seq;           // Seqlock sequence, odd while an update is in progress
+    uint32_t pad;
+    struct shm_record record;
+};
+
+typedef struct shm_writer shm_writer_t;
+
+struct shm_writer
+{
+    char name[SHM_NAME_MAX];
+    struct shm_segment *segment;
+};
+
+typedef struct shm_reader shm_reader_t;
+
+struct shm_reader
+{
+    struct shm_segment *segment;
+    uint64_t retries;       // Reads that had to be repeated because of a concurrent update
+};
+
+void shm_segment_name(char *buf, size_t cap, const char *device_id);
+int shm_writer_open(struct shm_writer **self, const char *device_id);
+void shm_publish(struct shm_writer *self, const struct shm_record *record);
+int shm_writer_close(struct shm_writer **self);
+
+int shm_reader_open(struct shm_reader **self, const char *device_id);
+int shm_read(struct shm_reader *self, struct shm_record *out);
+int shm_reader_close(struct shm_reader **self);
+
+#endif /* __SHM_H_ */
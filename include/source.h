@@ -0,0 +1,37 @@
+#ifndef __SOURCE_H_
+#define __SOURCE_H_
+
+#include <stddef.h>
+
+// Pluggable sensor backends. A source hands out samples in blocks so replayed traces can be
+// pushed through the averaging/logging pipeline without a call per reading.
+//
+// Binary trace layout: 8-byte magic "SSN1TRC1" followed by little-endian f64 samples.
+#define SOURCE_TRACE_MAGIC     "SSN1TRC1"
+#define SOURCE_TRACE_MAGIC_LEN 8
+
+struct ssn1_source;
+
+struct ssn1_source_ops
+{
+    const char *name;
+    // Reads up to max samples into out. Returns the number read, 0 at end of stream, -1 on error.
+    int  (*read)(struct ssn1_source *self, double *out, size_t max);
+    void (*close)(struct ssn1_source *self);
+};
+
+// Base structure embedded as the first member of every source implementation.
+struct ssn1_source
+{
+    const struct ssn1_source_ops *ops;
+};
+
+int source_sim_open(struct ssn1_source **self, double low, double high);
+int source_sim_open_seeded(struct ssn1_source **self, double low, double high, unsigned int seed);
+int source_csv_open(struct ssn1_source **self, const char *path);
+int source_trace_open(struct ssn1_source **self, const char *path);
+int source_open(struct ssn1_source **self, const char *path);
+int source_read(struct ssn1_source *self, double *out, size_t max);
+void source_close(struct ssn1_source **self);
+
+#endif /* __SOURCE_H_ */
@@ -2,10 +2,70 @@
 #define __SSN1_H__
 
 #include <time.h>
+#include <stdint.h>
 #include "http.h"
+#include "udp.h"
+#include "source.h"
+#include "stats.h"
+#include "shm.h"
 
 #define LOG_24_HOUR 1440
 #define N_READINGS 60
+#define SSN1_SAMPLE_BLOCK 256
+#define SSN1_DEVICE_ID "SSN1-UUID-12345"
+#define SSN1_HOST "httpbin.org"
+#define SSN1_PORT "80"
+#define SSN1_RETRY_AFTER_DEFAULT 60     // Hold used for a 429/503 without Retry-After
+#define SSN1_UPLOAD_INTERVAL_MAX 86400
+
+// Injectable time source. ssn1 reads time through this handle so a simulation can drive it
+// on virtual time; without one it falls back to time(NULL).
+struct ssn1_clock;
+typedef time_t (*ssn1_clock_fn)(struct ssn1_clock *self);
+struct ssn1_clock
+{
+    ssn1_clock_fn now_fn;
+};
+
+// Persistent part of the node: the 24h log ring and the partial averaging cycle.
+// It lives inside struct ssn1 by default, or in a memory-mapped snapshot file after
+// ssn1_attach_snapshot() so a restarted process picks up where it left off.
+// Crash safety: every log slot carries its own check, sealed once the minute is written, and
+// the log index is committed through two alternating commit records. The sealed slot is flushed
+// to disk (msync MS_SYNC) before the commit record that covers it is written, so a process crash
+// or a power loss between the two leaves the previous commit valid and at worst that minute is
+// lost, provided the storage honours the flush.
+// The file is the struct written raw: fixed-width fields without padding, host byte order.
+#define SSN1_SNAPSHOT_MAGIC   0x314E5353u // "SSN1"
+#define SSN1_SNAPSHOT_VERSION 3
+
+// One committed log index; the record with the highest seq and a matching check wins
+struct ssn1_commit
+{
+    uint64_t seq;
+    int32_t  log_idx;
+    uint32_t check;    // FNV-1a over seq and log_idx
+};
+
+typedef struct ssn1_store ssn1_store_t;
+
+struct ssn1_store
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;
+    uint32_t reserved;
+    struct ssn1_commit commit[2];
+    double   log[LOG_24_HOUR];
+    // Per-minute aggregates (min/max/stddev/p50/p95) stored alongside log[] at the same index
+    struct stats_summary log_stats[LOG_24_HOUR];
+    uint32_t log_check[LOG_24_HOUR];   // FNV-1a over log[i] and log_stats[i]
+    int32_t  log_idx;                  // Working index, restored from the newest valid commit
+    int32_t  read_count;
+    int64_t  read_cycle_start;         // time_t of the cycle's first reading
+    double   read_current_sum;
+    struct stats_window window;   // Streaming aggregate of the current averaging cycle
+};
 
 typedef struct ssn1 ssn1_t;
 
@@ -18,22 +78,101 @@ struct ssn1
     // to find the address of its parent ssn1_t structure.
     struct http_cb http_handle;
     struct http *http_ctx;
+    // Optional datagram transport for non-critical readings, set up by ssn1_use_udp().
+    // Acks from the receiver arrive through the embedded udp_handle.
+    struct tcp_cb udp_handle;
+    struct udp *udp_ctx;
     // ---------------------------------------------------------------------------------------//
+    struct ssn1_clock *clock;
+    // Handed to both HTTP clients while a clock is attached, so their backoff, breaker pauses and
+    // the alert latency stamps run on the same time base
+    struct tcp_clock link_clock_handle;
+    char   device_id[CODEC_DEVICE_ID_MAX];
+    // Optional sensor backend (owned). Samples are pulled a block at a time; without a source
+    // the built-in simulation in ssn1_sensor() is used.
+    struct ssn1_source *source;
+    double sample_block[SSN1_SAMPLE_BLOCK];
+    int    sample_pos;
+    int    sample_len;
+    int    source_eof;
     double temp_read;
     double temp_average;
     double low_th_warning;
     double high_th_warning;
     int    th_flag;
-    double log[LOG_24_HOUR];
-    int    log_idx;
+    // Log and cycle state: points at local_store, or at the mapping once a snapshot is attached
+    struct ssn1_store *store;
+    struct ssn1_store local_store;
+    size_t snapshot_len;
+    int    upload_stats;          // Include the aggregates in uploads
     time_t read_last;
-    time_t read_cycle_start;
-    double read_current_sum;
-    int    read_count;
     int    sending;
+    // Averages waiting for the HTTP link (upload in flight, backing off or circuit open).
+    // They go out together as one batch once http_ready() allows it.
+    struct temp_record spool[CODEC_MAX_BATCH];
+    int    spool_count;
+    struct temp_record inflight[CODEC_MAX_BATCH];
+    int    inflight_count;
+    unsigned long spool_dropped;
+    unsigned long upload_rejected;   // Averages dropped because the server refused them with a non-transient 4xx
+    // Server-driven pacing (see ssn1_http_callback): averages collect in the spool until upload_batch
+    // are waiting or upload_interval seconds have passed since the last upload, and no routine upload
+    // starts before upload_hold_until (429/503 Retry-After or a "retry_after" control member).
+    time_t upload_interval;
+    time_t upload_interval_set;   // Interval as configured, before a batch-only setting implied one
+    int    upload_batch;
+    time_t upload_hold_until;
+    time_t last_upload_time;
+    // rand_r() state for hold jitter and the built-in simulated sensor (ssn1_set_seed)
+    unsigned int seed;
+    unsigned long server_throttles;
+    // Report-by-exception policy: an average is uploaded when it moves more than report_deadband
+    // from the last sent value, when th_flag changes, or when report_heartbeat seconds pass
+    // without an upload. With both set to 0 every average is uploaded. "Sent" means accepted by
+    // the server: spooled or in-flight averages do not move the reference.
+    double report_deadband;
+    time_t report_heartbeat;
+    double last_sent_value;
+    int    last_sent_flag;
+    time_t last_sent_time;
+    int    has_sent;
+    unsigned long uploads_sent;
+    unsigned long uploads_suppressed;
+    // Per-reading alerting: every reading is checked against the thresholds. An alert is raised
+    // once readings stay out of range for alert_min_duration seconds and cleared once they are
+    // back at least alert_hysteresis inside the band. Alerts go out on their own HTTP client
+    // (alert_http_ctx) so they never wait behind a routine upload, and stay queued until the
+    // server answers with a 2xx; alert_seq tells whether a newer state was queued meanwhile.
+    double alert_hysteresis;
+    time_t alert_min_duration;
+    int    alert_active;
+    time_t alert_pending_since;          // Time of the first out-of-range reading, 0 if none
+    struct timespec alert_detected;      // Time of the reading that changed the alert state, on the links' clock
+    struct temp_record alert_record;     // Alert waiting for the priority lane
+    int    alert_queued;
+    int    alert_sending;
+    unsigned long alert_seq;             // Bumped for every alert queued
+    unsigned long alert_sent_seq;        // alert_seq of the alert in flight
+    unsigned long alerts_sent;
+    struct http_cb alert_handle;
+    struct http *alert_http_ctx;
+    // Optional local publication of the latest values for processes on the same box
+    struct shm_writer *shm_ctx;
 };
 
 int ssn1_init(struct ssn1 **self);
+int ssn1_init_udp(struct ssn1 **self, const char *host, const char *port, int ack_every);
+void ssn1_set_clock(struct ssn1 *self, struct ssn1_clock *clock);
+void ssn1_set_source(struct ssn1 *self, struct ssn1_source *source);
+void ssn1_set_device_id(struct ssn1 *self, const char *device_id);
+void ssn1_set_seed(struct ssn1 *self, unsigned int seed);
+void ssn1_set_upload_stats(struct ssn1 *self, int enable);
+void ssn1_set_report_policy(struct ssn1 *self, double deadband, time_t heartbeat);
+void ssn1_set_upload_pacing(struct ssn1 *self, time_t interval, int batch);
+void ssn1_set_alert_policy(struct ssn1 *self, double hysteresis, time_t min_duration);
+int ssn1_attach_snapshot(struct ssn1 *self, const char *path);
+int ssn1_use_shm(struct ssn1 *self);
+int ssn1_use_udp(struct ssn1 *self, const char *host, const char *port, int ack_every);
 int ssn1_work(struct ssn1 *self);
 int ssn1_dispose(struct ssn1 **self);
 
@@ -0,0 +1,50 @@
+#ifndef __STATS_H_
+#define __STATS_H_
+
+#include <stdint.h>
+
+// Streaming per-window aggregates in constant memory: count, mean and variance (Welford),
+// min/max, and P² quantile estimators (Jain & Chlamtac) for the median and p95.
+// No raw samples are kept, so the cost per reading does not depend on the window length.
+// Fields are fixed-width and leave no padding: a window is persisted raw in the node snapshot.
+
+struct p2_quantile
+{
+    double p;        // Target quantile (0..1)
+    double q[5];     // Marker heights
+    double n[5];     // Actual marker positions
+    double np[5];    // Desired marker positions
+    double dn[5];    // Desired position increments
+    int64_t count;
+};
+
+typedef struct stats_window stats_window_t;
+
+struct stats_window
+{
+    uint64_t count;
+    double mean;
+    double m2;
+    double min;
+    double max;
+    struct p2_quantile p50;
+    struct p2_quantile p95;
+};
+
+typedef struct stats_summary stats_summary_t;
+
+struct stats_summary
+{
+    double mean;
+    double min;
+    double max;
+    double stddev;
+    double p50;
+    double p95;
+};
+
+void stats_reset(struct stats_window *self);
+void stats_add(struct stats_window *self, double x);
+void stats_summarize(const struct stats_window *self, struct stats_summary *out);
+
+#endif /* __STATS_H_ */
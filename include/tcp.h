@@ -3,10 +3,13 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <time.h>
 
 struct http; // Forward declaration of the HTTP context for the container_of macro. 
 
 struct tcp_cb;
+// Called with every complete response. A non-zero return tells the retry policy the request
+// failed even though a response arrived (e.g. an HTTP error status).
 typedef int (*tcp_cb_fn)(struct tcp_cb *self, const char *data, size_t len);
 
 struct tcp_cb
@@ -14,6 +17,30 @@ struct tcp_cb
     tcp_cb_fn cb_fn;
 };
 
+// Injectable time source for the retry policy and the sent_at stamp. Without one the client reads
+// CLOCK_MONOTONIC; a simulation attaches one so backoff and breaker pauses run on virtual time.
+struct tcp_clock;
+typedef void (*tcp_clock_fn)(struct tcp_clock *self, struct timespec *now);
+struct tcp_clock
+{
+    tcp_clock_fn now_fn;
+};
+
+// In-memory stand-in for the network. exchange_fn gets the whole request and writes the whole
+// response, at most cap bytes, into response; a return of -1 is a transport failure (refused
+// connection, reset) and counts against the retry policy like one on a socket.
+struct tcp_transport;
+typedef int (*tcp_transport_fn)(struct tcp_transport *self, const char *request, size_t len, 
+                                char *response, size_t cap, size_t *response_len);
+struct tcp_transport
+{
+    tcp_transport_fn exchange_fn;
+};
+
+// Message framing for persistent connections: returns the length of the complete response at the
+// start of data, or 0 while more bytes are needed.
+typedef size_t (*tcp_frame_fn)(const char *data, size_t len);
+
 typedef enum 
 {
     TCP_STATE_IDLE,
@@ -25,6 +52,33 @@ typedef enum
     TCP_STATE_ERROR
 } tcp_state_t;
 
+// Circuit breaker states of the retry policy.
+// CLOSED: attempts allowed (subject to backoff). OPEN: attempts paused after repeated failures.
+// HALF_OPEN: the pause has expired, the next request is a single probe.
+typedef enum
+{
+    TCP_LINK_CLOSED,
+    TCP_LINK_OPEN,
+    TCP_LINK_HALF_OPEN
+} tcp_link_t;
+
+#define TCP_RETRY_BASE_MS    1000
+#define TCP_RETRY_MAX_MS     60000
+#define TCP_RETRY_OPEN_AFTER 5
+#define TCP_RETRY_OPEN_MS    300000
+
+struct tcp_retry
+{
+    unsigned base_ms;        // First backoff step
+    unsigned max_ms;         // Backoff cap
+    int      open_after;     // Consecutive failures that open the breaker
+    unsigned open_ms;        // How long the breaker stays open before a half-open probe
+    int      failures;       // Consecutive failed requests
+    unsigned backoff_ms;     // Jitter cap of the last backoff step, 0 once the breaker opened
+    tcp_link_t breaker;
+    struct timespec next_attempt; // Time before which no request is started (see tcp_clock)
+};
+
 typedef struct tcp tcp_t;
 
 struct tcp
@@ -36,14 +90,31 @@ struct tcp
     char *send_buffer;
     size_t send_len;
     size_t sent_bytes;
+    struct timespec sent_at; // Time the last request was fully handed to the kernel (see tcp_clock)
     char recv_buffer[4096];
     size_t recv_bytes;
+    struct tcp_retry retry;
+    unsigned int seed;       // rand_r() state for retry jitter, per client (tcp_set_seed)
+    // Set by tcp_set_keep_alive(): the connection is kept open after a response and reused for the
+    // next request. Without it every request opens a connection and reads until the server closes it.
+    tcp_frame_fn frame_fn;
+    int peer_closed;
+    // Set by tcp_set_clock() and tcp_set_transport(), NULL for CLOCK_MONOTONIC and real sockets.
+    struct tcp_clock *clock;
+    struct tcp_transport *transport;
     // Stores the pointer to the HTTP layer's embedded callback structure.    
     struct tcp_cb *http_handle; 
 };
 
 int tcp_init(struct tcp **self, const char *host, const char *port);
 void tcp_set_callback(struct tcp *self, struct tcp_cb *cb_handle, tcp_cb_fn fn);
+void tcp_set_keep_alive(struct tcp *self, tcp_frame_fn frame_fn);
+void tcp_set_retry_policy(struct tcp *self, unsigned base_ms, unsigned max_ms, int open_after, unsigned open_ms);
+void tcp_set_seed(struct tcp *self, unsigned int seed);
+void tcp_set_clock(struct tcp *self, struct tcp_clock *clock);
+void tcp_set_transport(struct tcp *self, struct tcp_transport *transport);
+int tcp_ready(struct tcp *self);
+tcp_link_t tcp_link_state(const struct tcp *self);
 int tcp_send_request(struct tcp *self, const char *data, size_t len);
 int tcp_work(struct tcp *self);
 int tcp_dispose(struct tcp **self);
@@ -0,0 +1,82 @@
+#ifndef __UDP_H_
+#define __UDP_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include "tcp.h"
+#include "codec.h"
+
+// Fire-and-forget datagram transport. Each datagram carries a sequence header followed by a
+// binary codec payload (see codec.h), so one or more records go out with a single send().
+//
+// Data datagram: 'S' 'U' | version u8 | flags u8 | epoch u32 | seq u32 | codec payload
+// Ack datagram:  'S' 'A' | version u8 | 0        | highest seq u32 | lost u32
+//
+// The epoch is picked at random when a sender is created and sequence numbers restart at 1 in
+// every epoch, so the receiver tells a restarted sender from a lost or wrapped sequence number.
+#define UDP_VERSION      2
+#define UDP_HDR_LEN      12
+#define UDP_ACK_LEN      12
+#define UDP_DGRAM_MAX    1400
+#define UDP_FLAG_ACK_REQ 0x01
+
+typedef struct udp udp_t;
+
+struct udp
+{
+    char *host;
+    char *port;
+    int sockfd;
+    uint32_t epoch;      // Identifies this sender instance, never 0
+    uint32_t seq;        // Sequence number of the last datagram sent
+    uint32_t acked_seq;  // Highest sequence number confirmed by the receiver
+    uint32_t lost;       // Loss reported by the receiver in its last ack
+    int ack_every;       // Request a cumulative ack every N datagrams (0 disables acks)
+    int ack_pending;     // An ack was requested and has not arrived yet
+    char recv_buffer[64];
+    // Stores the pointer to the parent's embedded callback structure, called for every ack.
+    // Uses the same callback type as struct tcp so either transport fits the same chain.
+    struct tcp_cb *ack_handle;
+};
+
+int udp_init(struct udp **self, const char *host, const char *port, int ack_every);
+void udp_set_callback(struct udp *self, struct tcp_cb *cb_handle, tcp_cb_fn fn);
+int udp_send_records(struct udp *self, const char *device_id, const struct temp_record *records, size_t count);
+int udp_work(struct udp *self);
+int udp_dispose(struct udp **self);
+
+// Local receiver: tracks sequence gaps per sender, answers ack requests and hands each
+// codec payload to its callback. Used as a loopback sink for the UDP transport.
+struct udp_rx_peer
+{
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    uint32_t epoch;      // Epoch of the sender's current run, 0 before its first datagram
+    uint32_t expected;   // Next sequence number expected from this sender
+    uint32_t lost;       // Datagrams missing from the sequence so far
+};
+
+typedef struct udp_rx udp_rx_t;
+
+struct udp_rx
+{
+    int sockfd;
+    unsigned short port;
+    struct udp_rx_peer **peers;   // Open-addressing table keyed by sender address
+    size_t n_peers;
+    size_t cap_peers;
+    uint64_t received;
+    uint64_t lost;
+    uint64_t acks_sent;
+    char recv_buffer[UDP_DGRAM_MAX];
+    // Stores the pointer to the parent's embedded callback structure, called with each codec payload.
+    struct tcp_cb *data_handle;
+};
+
+int udp_rx_init(struct udp_rx **self, const char *bind_host, const char *port);
+void udp_rx_set_callback(struct udp_rx *self, struct tcp_cb *cb_handle, tcp_cb_fn fn);
+int udp_rx_work(struct udp_rx *self);
+int udp_rx_dispose(struct udp_rx **self);
+
+#endif /* __UDP_H_ */
@@ -5,7 +5,7 @@
 
 int main(int argc, char *argv[])
 {
-    if (argc != 3)
+    if (argc != 3 && argc != 4)
     {
         printf("### SSN-1: Smart Sensor Node 1 ### \n"
                "- A temperature monitoring program for industrial use\n"
@@ -14,8 +14,9 @@ int main(int argc, char *argv[])
                "The calculated average is logged by the device (rolling 24 hours, oldest then gets deleted) and is then sent off to the designated server via TCP/HTTP.\n"
                "\n"
                "The user sets a low and high threshold warning for the system as shown below\n"
-               "Usage: %s <low threshold warning> <high threshold warning>\n"
-               "Example: ./ssn-1 3.14 4.20\n", argv[0]);
+               "An optional snapshot file keeps the log and the current cycle across restarts.\n"
+               "Usage: %s <low threshold warning> <high threshold warning> [snapshot file]\n"
+               "Example: ./ssn-1 3.14 4.20 ssn-1.snap\n", argv[0]);
         return -1;
     }
 
@@ -40,6 +41,19 @@ int main(int argc, char *argv[])
         return -1;
     }
 
+    if (argc == 4 && ssn1_attach_snapshot(self, argv[3]) < 0)
+    {
+        printf("Failed to attach snapshot %s\n", argv[3]);
+        ssn1_dispose(&self);
+        return -1;
+    }
+
+    // Local consumers (HMI, PLC bridge) read the latest values from shared memory
+    if (ssn1_use_shm(self) != 0)
+    {
+        printf("Shared-memory publication unavailable, continuing without it.\n");
+    }
+
     self->low_th_warning  = low_temp_th;
     self->high_th_warning = high_temp_th;
 
@@ -55,6 +69,10 @@ int main(int argc, char *argv[])
         {
             printf("[WARNING] Threshold breached!\n");
         }
+        else if (rv == 3)
+        {
+            printf("[ALERT] Reading outside thresholds!\n");
+        }
         else 
         {
             usleep(10000); // Avoid busy wait
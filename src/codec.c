@@ -0,0 +1,716 @@
+#include "codec.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+/**
+ * @Brief: Writes a 16-bit value into a buffer in little-endian byte order.
+ * @Param: p Destination buffer (at least 2 bytes).
+ * @Param: v The value to write.
+ * @Return: void
+ */
+static void codec_put_le16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v);
+    p[1] = (uint8_t)(v >> 8);
+}
+
+/**
+ * @Brief: Writes a 64-bit value into a buffer in little-endian byte order.
+ * @Param: p Destination buffer (at least 8 bytes).
+ * @Param: v The value to write.
+ * @Return: void
+ */
+static void codec_put_le64(uint8_t *p, uint64_t v)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+/**
+ * @Brief: Writes a float into a buffer as a little-endian 32-bit IEEE 754 value.
+ * @Param: p Destination buffer (at least 4 bytes).
+ * @Param: f The value to write.
+ * @Return: void
+ */
+static void codec_put_f32(uint8_t *p, float f)
+{
+    uint32_t v;
+    memcpy(&v, &f, sizeof(v));
+    for (int i = 0; i < 4; i++)
+    {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+/**
+ * @Brief: Reads a little-endian 32-bit IEEE 754 value from a buffer.
+ * @Param: p Source buffer (at least 4 bytes).
+ * @Return: The decoded value.
+ */
+static float codec_get_f32(const uint8_t *p)
+{
+    uint32_t v = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    float f;
+    memcpy(&f, &v, sizeof(f));
+    return f;
+}
+
+/**
+ * @Brief: Reads a little-endian 16-bit value from a buffer.
+ * @Param: p Source buffer (at least 2 bytes).
+ * @Return: The decoded value.
+ */
+static uint16_t codec_get_le16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+/**
+ * @Brief: Reads a little-endian 64-bit value from a buffer.
+ * @Param: p Source buffer (at least 8 bytes).
+ * @Return: The decoded value.
+ */
+static uint64_t codec_get_le64(const uint8_t *p)
+{
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--)
+    {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+/**
+ * @Brief: Formats a timestamp as local time, matching the original JSON layout.
+ * @Param: buf Destination string buffer.
+ * @Param: cap Size of the destination buffer.
+ * @Param: timestamp The time to format.
+ * @Return: void
+ */
+static void codec_format_time(char *buf, size_t cap, time_t timestamp)
+{
+    struct tm tm_info;
+    localtime_r(&timestamp, &tm_info);
+    strftime(buf, cap, "%Y-%m-%d %H:%M:%S", &tm_info);
+}
+
+/**
+ * @Brief: Formats the optional window aggregates of a record as extra JSON members.
+ * @Param: buf Destination string buffer.
+ * @Param: cap Size of the destination buffer.
+ * @Param: record The record to format.
+ * @Param: sep Separator placed before each member.
+ * @Return: void (an empty string when the record carries no aggregates)
+ */
+static void codec_format_stats(char *buf, size_t cap, const struct temp_record *record, const char *sep)
+{
+    buf[0] = '\0';
+    if (!record->has_stats) return;
+    snprintf(buf, cap, "%s\"min\": %.2f%s\"max\": %.2f%s\"stddev\": %.3f%s\"p95\": %.2f",
+             sep, record->min, sep, record->max, sep, record->stddev, sep, record->p95);
+}
+
+/**
+ * @Brief: Writes a string as the contents of a JSON string literal, escaping quotes, backslashes and
+ *         control characters.
+ * @Param: buf Destination buffer.
+ * @Param: cap Size of the destination buffer.
+ * @Param: s NUL-terminated input.
+ * @Return: Length of the escaped text (excluding the terminator), -1 if it does not fit.
+ */
+static int codec_json_escape(char *buf, size_t cap, const char *s)
+{
+    static const char hex[] = "0123456789abcdef";
+    size_t n = 0;
+    for (; *s; s++)
+    {
+        unsigned char c = (unsigned char)*s;
+        if (n + 7 > cap) return -1;   // Longest escape plus the terminator
+        if (c == '"' || c == '\\')
+        {
+            buf[n++] = '\\';
+            buf[n++] = (char)c;
+        }
+        else if (c < 0x20)
+        {
+            memcpy(buf + n, "\\u00", 4);
+            buf[n + 4] = hex[c >> 4];
+            buf[n + 5] = hex[c & 0xF];
+            n += 6;
+        }
+        else
+        {
+            buf[n++] = (char)c;
+        }
+    }
+    if (n >= cap) return -1;
+    buf[n] = '\0';
+    return (int)n;
+}
+
+/**
+ * @Brief: Encodes one or more records as a JSON document. A single record keeps the original flat layout,
+ *         batches are sent as a "records" array under one device id.
+ * @Param: buf Destination buffer.
+ * @Param: cap Size of the destination buffer.
+ * @Param: device_id A unique identifier for the sensor.
+ * @Param: records Array of records to encode.
+ * @Param: count Number of records in the array (1..CODEC_MAX_BATCH).
+ * @Return: Length of the encoded document (excluding the terminator), -1 if it does not fit.
+ */
+int codec_json_encode(char *buf, size_t cap, const char *device_id,
+                      const struct temp_record *records, size_t count)
+{
+    if (!buf || !records || count == 0 || count > CODEC_MAX_BATCH) return -1;
+
+    char time_str[64];
+    char stats_str[128];
+    char id_str[CODEC_DEVICE_ID_MAX * 6];   // Worst case: every byte escaped as \u00XX
+    int len;
+
+    if (codec_json_escape(id_str, sizeof(id_str), device_id) < 0) return -1;
+
+    if (count == 1)
+    {
+        codec_format_time(time_str, sizeof(time_str), records[0].timestamp);
+        codec_format_stats(stats_str, sizeof(stats_str), &records[0], ",\n  ");
+        len = snprintf(buf, cap,
+            "{\n"
+            "  \"device\": \"%s\",\n"
+            "  \"time\": \"%s\",\n"
+            "  \"temperature\": \"%.2f°C\",\n"
+            "  \"threshold_broken\": \"%d\"%s\n"
+            "}",
+            id_str, time_str, records[0].temperature, records[0].threshold_flag, stats_str);
+        return (len < 0 || (size_t)len >= cap) ? -1 : len;
+    }
+
+    len = snprintf(buf, cap,
+        "{\n"
+        "  \"device\": \"%s\",\n"
+        "  \"records\": [\n", id_str);
+    if (len < 0 || (size_t)len >= cap) return -1;
+
+    size_t off = (size_t)len;
+    for (size_t i = 0; i < count; i++)
+    {
+        codec_format_time(time_str, sizeof(time_str), records[i].timestamp);
+        codec_format_stats(stats_str, sizeof(stats_str), &records[i], ", ");
+        len = snprintf(buf + off, cap - off,
+            "    {\"time\": \"%s\", \"temperature\": \"%.2f°C\", \"threshold_broken\": \"%d\"%s}%s\n",
+            time_str, records[i].temperature, records[i].threshold_flag, stats_str,
+            i + 1 < count ? "," : "");
+        if (len < 0 || (size_t)len >= cap - off) return -1;
+        off += (size_t)len;
+    }
+
+    len = snprintf(buf + off, cap - off, "  ]\n}");
+    if (len < 0 || (size_t)len >= cap - off) return -1;
+    return (int)(off + (size_t)len);
+}
+
+/**
+ * @Brief: Encodes one or more records in the compact binary layout described in codec.h.
+ * @Param: buf Destination buffer.
+ * @Param: cap Size of the destination buffer.
+ * @Param: device_id A unique identifier for the sensor (at most 255 bytes).
+ * @Param: records Array of records to encode.
+ * @Param: count Number of records in the array (1..CODEC_MAX_BATCH).
+ * @Return: Number of bytes written, -1 if the input is invalid or does not fit.
+ */
+int codec_bin_encode(uint8_t *buf, size_t cap, const char *device_id,
+                     const struct temp_record *records, size_t count)
+{
+    if (!buf || !device_id || !records || count == 0 || count > CODEC_MAX_BATCH) return -1;
+
+    size_t id_len = strlen(device_id);
+    if (id_len > 255) return -1;
+
+    // Aggregates are sent for the whole batch if any record carries them
+    int with_stats = 0;
+    for (size_t i = 0; i < count; i++) with_stats |= records[i].has_stats;
+
+    size_t rec_len = CODEC_BIN_REC_LEN + (with_stats ? CODEC_BIN_STATS_LEN : 0);
+    size_t total = CODEC_BIN_HDR_LEN + id_len + count * rec_len;
+    if (total > cap) return -1;
+
+    uint8_t *p = buf;
+    p[0] = CODEC_BIN_MAGIC_0;
+    p[1] = CODEC_BIN_MAGIC_1;
+    p[2] = CODEC_BIN_VERSION;
+    p[3] = with_stats ? CODEC_FLAG_STATS : 0;
+    codec_put_le16(p + 4, (uint16_t)count);
+    p[6] = (uint8_t)id_len;
+    memcpy(p + CODEC_BIN_HDR_LEN, device_id, id_len);
+    p += CODEC_BIN_HDR_LEN + id_len;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        uint64_t temp_bits;
+        memcpy(&temp_bits, &records[i].temperature, sizeof(temp_bits));
+        codec_put_le64(p, (uint64_t)(int64_t)records[i].timestamp);
+        codec_put_le64(p + 8, temp_bits);
+        p[16] = records[i].threshold_flag ? 1 : 0;
+        if (with_stats)
+        {
+            codec_put_f32(p + 17, records[i].min);
+            codec_put_f32(p + 21, records[i].max);
+            codec_put_f32(p + 25, records[i].stddev);
+            codec_put_f32(p + 29, records[i].p95);
+        }
+        p += rec_len;
+    }
+
+    return (int)total;
+}
+
+/**
+ * @Brief: Decodes a binary payload produced by codec_bin_encode.
+ * @Param: buf Source buffer.
+ * @Param: len Length of the source buffer.
+ * @Param: device_id Destination for the null terminated device id.
+ * @Param: id_cap Size of the device id buffer.
+ * @Param: records Destination array for the decoded records.
+ * @Param: max Capacity of the records array.
+ * @Return: Number of records decoded, -1 on a malformed payload, an unsupported version or more than max records.
+ */
+int codec_bin_decode(const uint8_t *buf, size_t len, char *device_id, size_t id_cap,
+                     struct temp_record *records, size_t max)
+{
+    if (!buf || len < CODEC_BIN_HDR_LEN) return -1;
+    if (buf[0] != CODEC_BIN_MAGIC_0 || buf[1] != CODEC_BIN_MAGIC_1) return -1;
+    if (buf[2] != CODEC_BIN_VERSION) return -1;
+
+    int with_stats = buf[3] & CODEC_FLAG_STATS;
+    size_t rec_len = CODEC_BIN_REC_LEN + (with_stats ? CODEC_BIN_STATS_LEN : 0);
+    size_t count   = codec_get_le16(buf + 4);
+    size_t id_len  = buf[6];
+    if (count > max || id_len >= id_cap) return -1;
+    if (len != CODEC_BIN_HDR_LEN + id_len + count * rec_len) return -1;
+
+    memcpy(device_id, buf + CODEC_BIN_HDR_LEN, id_len);
+    device_id[id_len] = '\0';
+
+    const uint8_t *p = buf + CODEC_BIN_HDR_LEN + id_len;
+    for (size_t i = 0; i < count; i++)
+    {
+        uint64_t temp_bits = codec_get_le64(p + 8);
+        records[i].timestamp = (time_t)(int64_t)codec_get_le64(p);
+        memcpy(&records[i].temperature, &temp_bits, sizeof(temp_bits));
+        records[i].threshold_flag = p[16];
+        records[i].has_stats      = with_stats ? 1 : 0;
+        records[i].min            = with_stats ? codec_get_f32(p + 17) : 0.0f;
+        records[i].max            = with_stats ? codec_get_f32(p + 21) : 0.0f;
+        records[i].stddev         = with_stats ? codec_get_f32(p + 25) : 0.0f;
+        records[i].p95            = with_stats ? codec_get_f32(p + 29) : 0.0f;
+        p += rec_len;
+    }
+
+    return (int)count;
+}
+
+/**
+ * @Brief: Maps a Content-Type header value to a wire format. Parameters such as "; charset=" are ignored.
+ * @Param: content_type The header value (not necessarily null terminated).
+ * @Param: len Length of the header value.
+ * @Return: The matching codec_format_t, CODEC_FORMAT_UNKNOWN if unsupported.
+ */
+codec_format_t codec_format_from_content_type(const char *content_type, size_t len)
+{
+    if (!content_type) return CODEC_FORMAT_UNKNOWN;
+
+    size_t n = 0;
+    while (n < len && content_type[n] != ';' && content_type[n] != ' ') n++;
+
+    if (n == strlen(CODEC_CT_JSON) && strncasecmp(content_type, CODEC_CT_JSON, n) == 0)
+    {
+        return CODEC_FORMAT_JSON;
+    }
+    if (n == strlen(CODEC_CT_BINARY) && strncasecmp(content_type, CODEC_CT_BINARY, n) == 0)
+    {
+        return CODEC_FORMAT_BINARY;
+    }
+    return CODEC_FORMAT_UNKNOWN;
+}
+
+/**
+ * @Brief: Returns the Content-Type header value for a wire format.
+ * @Param: format The wire format.
+ * @Return: A static string with the MIME type.
+ */
+const char *codec_content_type(codec_format_t format)
+{
+    return format == CODEC_FORMAT_BINARY ? CODEC_CT_BINARY : CODEC_CT_JSON;
+}
+
+/**
+ * @Brief: Skips JSON whitespace.
+ * @Param: p Current position.
+ * @Param: end End of the text.
+ * @Return: The first non-whitespace position, end if none.
+ */
+static const char *codec_json_ws(const char *p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+    return p;
+}
+
+/**
+ * @Brief: Finds the closing quote of a JSON string, honouring backslash escapes.
+ * @Param: p First byte after the opening quote.
+ * @Param: end End of the text.
+ * @Return: Pointer to the closing quote, NULL if the string is unterminated.
+ */
+static const char *codec_json_string_end(const char *p, const char *end)
+{
+    while (p < end)
+    {
+        const char *q = memchr(p, '"', (size_t)(end - p));
+        if (!q) return NULL;
+        // The quote is escaped if an odd number of backslashes precede it
+        const char *b = q;
+        while (b > p && b[-1] == '\\') b--;
+        if (((q - b) & 1) == 0) return q;
+        p = q + 1;
+    }
+    return NULL;
+}
+
+// Bytes that change the structure of a JSON text; everything else is skipped with one table lookup
+static const unsigned char codec_json_structural[256] =
+{
+    ['"'] = 1, ['{'] = 1, ['}'] = 1, ['['] = 1, [']'] = 1
+};
+
+/**
+ * @Brief: Skips one JSON value: a string, a nested object or array, or a scalar.
+ * @Param: value First byte of the value.
+ * @Param: end End of the text.
+ * @Return: Pointer just past the value, NULL if it is unterminated.
+ */
+static const char *codec_json_skip(const char *value, const char *end)
+{
+    if (value >= end) return NULL;
+    if (*value == '"')
+    {
+        const char *q = codec_json_string_end(value + 1, end);
+        return q ? q + 1 : NULL;
+    }
+    if (*value != '{' && *value != '[')
+    {
+        const char *p = value;
+        while (p < end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') p++;
+        return p;
+    }
+
+    int depth = 0;
+    for (const char *p = value; p < end; p++)
+    {
+        while (p < end && !codec_json_structural[(unsigned char)*p]) p++;
+        if (p >= end) break;
+        if (*p == '"')
+        {
+            p = codec_json_string_end(p + 1, end);
+            if (!p) return NULL;
+        }
+        else if (*p == '{' || *p == '[') depth++;
+        else if ((*p == '}' || *p == ']') && --depth == 0) return p + 1;
+    }
+    return NULL;
+}
+
+/**
+ * @Brief: Finds a top-level member of a JSON object without copying or terminating the input. Members of
+ *         nested objects and text inside strings never match, and the scan stops where the object closes.
+ * @Param: object Start of the object text (its opening brace, optionally after whitespace).
+ * @Param: end End of the object text.
+ * @Param: key Member name without quotes.
+ * @Return: Pointer to the first byte of the value (opening quote included), NULL if the member is missing.
+ */
+static const char *codec_json_find(const char *object, const char *end, const char *key)
+{
+    size_t key_len = strlen(key);
+    const char *p = codec_json_ws(object, end);
+    if (p >= end || *p != '{') return NULL;
+
+    int depth = 0;
+    for (; p < end; p++)
+    {
+        while (p < end && !codec_json_structural[(unsigned char)*p]) p++;
+        if (p >= end) break;
+        if (*p == '"')
+        {
+            const char *name = p + 1;
+            p = codec_json_string_end(name, end);
+            if (!p) return NULL;
+            if (depth != 1) continue;
+
+            // A string at the object's own level followed by ':' is a member name
+            const char *v = codec_json_ws(p + 1, end);
+            if (v >= end || *v != ':') continue;
+            if ((size_t)(p - name) != key_len || memcmp(name, key, key_len) != 0) continue;
+            v = codec_json_ws(v + 1, end);
+            return v < end ? v : NULL;
+        }
+        else if (*p == '{' || *p == '[') depth++;
+        else if ((*p == '}' || *p == ']') && --depth == 0) return NULL;
+    }
+    return NULL;
+}
+
+/**
+ * @Brief: Parses a number (optionally quoted, with trailing text such as a unit) at a JSON value.
+ * @Param: value Pointer returned by codec_json_find().
+ * @Param: end End of the enclosing object text.
+ * @Param: out Destination, left untouched on failure.
+ * @Return: 1 on success, 0 if the value is not a number.
+ */
+static int codec_json_number(const char *value, const char *end, double *out)
+{
+    if (!value) return 0;
+    if (*value == '"') value++;
+
+    // Copy only the numeric token so strtod never reads past the object
+    char num[32];
+    size_t n = 0;
+    while (value + n < end && n < sizeof(num) - 1 && strchr("+-0123456789.eE", value[n]) && value[n]) n++;
+    if (n == 0) return 0;
+    memcpy(num, value, n);
+    num[n] = '\0';
+
+    char *num_end;
+    double v = strtod(num, &num_end);
+    if (num_end == num) return 0;
+    *out = v;
+    return 1;
+}
+
+/**
+ * @Brief: Reads one integer member of a flat JSON object.
+ * @Param: object Start of the object text.
+ * @Param: end End of the object text.
+ * @Param: key Member name without quotes.
+ * @Param: out Destination, left untouched if the member is missing or not a number.
+ * @Return: 1 if the member was found, 0 otherwise.
+ */
+static int codec_json_long(const char *object, const char *end, const char *key, long *out)
+{
+    double v;
+    if (!codec_json_number(codec_json_find(object, end, key), end, &v)) return 0;
+    *out = (long)v;
+    return 1;
+}
+
+/**
+ * @Brief: Converts the local "YYYY-MM-DD HH:MM:SS" time written by codec_format_time() back to time_t.
+ *         mktime() is only called once per hour of input; the per-thread cache keeps decoders on
+ *         different threads independent.
+ * @Param: value Pointer to the opening quote of the time string.
+ * @Param: end End of the enclosing object text.
+ * @Param: out Destination timestamp.
+ * @Return: 1 on success, 0 on a malformed time.
+ */
+static int codec_json_time(const char *value, const char *end, time_t *out)
+{
+    static __thread int cached_key = -1;
+    static __thread time_t cached_hour;
+
+    if (!value || *value != '"' || end - value < 20) return 0;
+    const char *t = value + 1;
+    int f[6];
+    static const int off[6] = { 0, 5, 8, 11, 14, 17 };
+    static const int width[6] = { 4, 2, 2, 2, 2, 2 };
+    for (int i = 0; i < 6; i++)
+    {
+        f[i] = 0;
+        for (int k = 0; k < width[i]; k++)
+        {
+            char c = t[off[i] + k];
+            if (c < '0' || c > '9') return 0;
+            f[i] = f[i] * 10 + (c - '0');
+        }
+    }
+
+    int key = ((f[0] * 12 + f[1]) * 31 + f[2]) * 24 + f[3];
+    if (key != cached_key)
+    {
+        struct tm tm;
+        memset(&tm, 0, sizeof(tm));
+        tm.tm_year  = f[0] - 1900;
+        tm.tm_mon   = f[1] - 1;
+        tm.tm_mday  = f[2];
+        tm.tm_hour  = f[3];
+        tm.tm_isdst = -1;
+        cached_hour = mktime(&tm);
+        cached_key  = key;
+    }
+    *out = cached_hour + f[4] * 60 + f[5];
+    return 1;
+}
+
+/**
+ * @Brief: Copies the contents of a JSON string literal, resolving its escapes. \\uXXXX outside ASCII
+ *         is written as UTF-8; surrogate pairs are not supported.
+ * @Param: p First byte after the opening quote.
+ * @Param: q The closing quote.
+ * @Param: out Destination (NUL-terminated, truncated to cap - 1).
+ * @Param: cap Size of the destination.
+ * @Return: 0 on success, -1 on a malformed escape.
+ */
+static int codec_json_unescape(const char *p, const char *q, char *out, size_t cap)
+{
+    size_t n = 0;
+    while (p < q)
+    {
+        char utf8[3];
+        size_t len = 1;
+        utf8[0] = *p++;
+        if (utf8[0] == '\\')
+        {
+            if (p >= q) return -1;
+            char e = *p++;
+            switch (e)
+            {
+                case '"': case '\\': case '/': utf8[0] = e; break;
+                case 'b': utf8[0] = '\b'; break;
+                case 'f': utf8[0] = '\f'; break;
+                case 'n': utf8[0] = '\n'; break;
+                case 'r': utf8[0] = '\r'; break;
+                case 't': utf8[0] = '\t'; break;
+                case 'u':
+                {
+                    unsigned v = 0;
+                    for (int i = 0; i < 4; i++, p++)
+                    {
+                        if (p >= q) return -1;
+                        char c = *p;
+                        int d = (c >= '0' && c <= '9') ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10
+                              : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+                        if (d < 0) return -1;
+                        v = v * 16 + (unsigned)d;
+                    }
+                    if (v == 0 || (v >= 0xD800 && v <= 0xDFFF)) return -1;
+                    if (v < 0x80)       { utf8[0] = (char)v; }
+                    else if (v < 0x800) { utf8[0] = (char)(0xC0 | (v >> 6)); utf8[1] = (char)(0x80 | (v & 0x3F)); len = 2; }
+                    else                { utf8[0] = (char)(0xE0 | (v >> 12)); utf8[1] = (char)(0x80 | ((v >> 6) & 0x3F));
+                                          utf8[2] = (char)(0x80 | (v & 0x3F)); len = 3; }
+                    break;
+                }
+                default: return -1;
+            }
+        }
+        for (size_t i = 0; i < len && n < cap - 1; i++) out[n++] = utf8[i];
+    }
+    out[n] = '\0';
+    return 0;
+}
+
+/**
+ * @Brief: Decodes one record object of a JSON upload.
+ * @Param: object Start of the record object.
+ * @Param: end End of the record object.
+ * @Param: record Destination record.
+ * @Return: 0 on success, -1 if a required member is missing.
+ */
+static int codec_json_record(const char *object, const char *end, struct temp_record *record)
+{
+    double flag = 0.0;
+    memset(record, 0, sizeof(*record));
+    if (!codec_json_time(codec_json_find(object, end, "time"), end, &record->timestamp)) return -1;
+    if (!codec_json_number(codec_json_find(object, end, "temperature"), end, &record->temperature)) return -1;
+    codec_json_number(codec_json_find(object, end, "threshold_broken"), end, &flag);
+    record->threshold_flag = (int)flag;
+
+    double min, max, stddev, p95;
+    if (codec_json_number(codec_json_find(object, end, "min"), end, &min) &&
+        codec_json_number(codec_json_find(object, end, "max"), end, &max) &&
+        codec_json_number(codec_json_find(object, end, "stddev"), end, &stddev) &&
+        codec_json_number(codec_json_find(object, end, "p95"), end, &p95))
+    {
+        record->has_stats = 1;
+        record->min       = (float)min;
+        record->max       = (float)max;
+        record->stddev    = (float)stddev;
+        record->p95       = (float)p95;
+    }
+    return 0;
+}
+
+/**
+ * @Brief: Decodes a JSON upload produced by codec_json_encode(), single record or batch. The input is
+ *         scanned in place: it need not be NUL-terminated and nothing but the device id is copied.
+ * @Param: buf The JSON document.
+ * @Param: len Length of the document.
+ * @Param: device_id Destination for the device id (NUL-terminated, truncated to id_cap - 1).
+ * @Param: id_cap Size of the device_id buffer.
+ * @Param: records Destination array.
+ * @Param: max Capacity of the records array.
+ * @Return: Number of records decoded, -1 on malformed input or if it holds more than max records.
+ */
+int codec_json_decode(const char *buf, size_t len, char *device_id, size_t id_cap,
+                      struct temp_record *records, size_t max)
+{
+    if (!buf || !records || max == 0 || id_cap == 0) return -1;
+    const char *end = buf + len;
+
+    const char *id = codec_json_find(buf, end, "device");
+    if (!id || *id != '"') return -1;
+    const char *id_end = codec_json_string_end(id + 1, end);
+    if (!id_end || codec_json_unescape(id + 1, id_end, device_id, id_cap) != 0) return -1;
+
+    const char *array = codec_json_find(buf, end, "records");
+    if (!array)
+    {
+        return codec_json_record(buf, end, &records[0]) == 0 ? 1 : -1;
+    }
+    if (*array != '[') return -1;
+
+    // Elements are delimited by codec_json_skip(), so braces inside strings never split a record
+    size_t count = 0;
+    const char *p = codec_json_ws(array + 1, end);
+    while (p < end && *p != ']')
+    {
+        // Records past max would be acknowledged without being stored; refuse the whole batch
+        if (count == max || *p != '{') return -1;
+        const char *close = codec_json_skip(p, end);
+        if (!close) return -1;
+        if (codec_json_record(p, close, &records[count]) != 0) return -1;
+        count++;
+        p = codec_json_ws(close, end);
+        if (p < end && *p == ',') p = codec_json_ws(p + 1, end);
+    }
+    if (p >= end) return -1;
+    return count > 0 ? (int)count : -1;
+}
+
+/**
+ * @Brief: Extracts the top-level "control" object from a JSON response body. Anything else in the body,
+ *         including a "control" member nested deeper or text inside strings, is ignored.
+ * @Param: body NUL-terminated response body.
+ * @Param: control Destination; every member is set to -1 unless the server supplied it.
+ * @Return: Number of members found, 0 if the body has no control section.
+ */
+int codec_control_decode(const char *body, struct codec_control *control)
+{
+    control->interval    = -1;
+    control->batch       = -1;
+    control->retry_after = -1;
+    if (!body) return 0;
+
+    const char *body_end = body + strlen(body);
+    const char *object = codec_json_find(body, body_end, "control");
+    if (!object || *object != '{') return 0;
+    const char *end = codec_json_skip(object, body_end);
+    if (!end) return 0;
+
+    int found = 0;
+    found += codec_json_long(object, end, "interval", &control->interval);
+    found += codec_json_long(object, end, "batch", &control->batch);
+    found += codec_json_long(object, end, "retry_after", &control->retry_after);
+    return found;
+}
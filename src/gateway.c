@@ -0,0 +1,533 @@
+#define _GNU_SOURCE
+#include "gateway.h"
+#include "ssn-1.h"
+#include "log.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/epoll.h>
+
+// Everything below is private to one shard thread and allocated by it, so the memory
+// lands on the shard's own core and no other thread ever touches it.
+struct shard_loop
+{
+    struct shard *shard;
+    struct ssn1_clock clock_handle;
+    time_t now;
+    struct tcp_cb rx_handle;
+    struct udp_rx *rx;
+    struct tcp_transport transport_handle;
+    unsigned int server_seed;   // rand_r() state deciding the in-memory server's answers
+    int epfd;
+    uint64_t sent;      // Datagrams the shard's nodes have sent that the receiver should expect
+    struct ssn1 **nodes;
+    struct gateway_stats stats;
+};
+
+/**
+ * @Brief: Returns CLOCK_MONOTONIC time in seconds.
+ * @Return: Seconds as a double.
+ */
+static double gateway_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/**
+ * @Brief: Clock callback returning the shard's virtual time.
+ * @Param: cb_handle Pointer to the embedded ssn1_clock structure.
+ * @Return: The current virtual time.
+ */
+static time_t shard_clock_now(struct ssn1_clock *cb_handle)
+{
+    struct shard_loop *self = CONTAINER_OF(cb_handle, struct shard_loop, clock_handle);
+    return self->now;
+}
+
+/**
+ * @Brief: Receiver callback counting the records carried by each datagram.
+ * @Param: cb_handle Pointer to the embedded tcp_cb structure.
+ * @Param: data The codec payload of the datagram.
+ * @Param: len The length of the payload.
+ * @Return: 0 on success, -1 on a malformed payload.
+ */
+static int shard_rx_callback(struct tcp_cb *cb_handle, const char *data, size_t len)
+{
+    struct shard_loop *self = CONTAINER_OF(cb_handle, struct shard_loop, rx_handle);
+    char device_id[CODEC_DEVICE_ID_MAX];
+    struct temp_record records[CODEC_MAX_BATCH];
+
+    int n = codec_bin_decode((const uint8_t *)data, len, device_id, sizeof(device_id), records, CODEC_MAX_BATCH);
+    if (n < 0) return -1;
+    self->stats.received += (uint64_t)n;
+    return 0;
+}
+
+/**
+ * @Brief: In-memory HTTP server of the shard: fails or sheds the configured share of requests and
+ *         accepts the rest, counting the records of every accepted upload.
+ * @Param: cb_handle Pointer to the embedded tcp_transport structure.
+ * @Param: request The raw request.
+ * @Param: len The length of the request.
+ * @Param: response Destination for the raw response.
+ * @Param: cap Capacity of response.
+ * @Param: response_len Length of the response written.
+ * @Return: 0 if the request was answered, -1 for a transport failure.
+ */
+static int shard_http_exchange(struct tcp_transport *cb_handle, const char *request, size_t len,
+                               char *response, size_t cap, size_t *response_len)
+{
+    struct shard_loop *self = CONTAINER_OF(cb_handle, struct shard_loop, transport_handle);
+    const struct gateway_config *config = &self->shard->gateway->config;
+    double draw = (double)rand_r(&self->server_seed) / ((double)RAND_MAX + 1.0);
+
+    if (draw < config->http_fail)
+    {
+        self->stats.refused++;
+        return -1;
+    }
+    self->stats.requests++;
+
+    const char *status = "200 OK";
+    char retry[32] = "";
+    if (draw < config->http_fail + config->http_busy)
+    {
+        status = "503 Service Unavailable";
+        snprintf(retry, sizeof(retry), "Retry-After: %d\r\n", GATEWAY_RETRY_AFTER);
+        self->stats.throttled++;
+    }
+    else
+    {
+        char device_id[CODEC_DEVICE_ID_MAX];
+        struct temp_record records[CODEC_MAX_BATCH];
+        const char *body = memmem(request, len, "\r\n\r\n", 4);
+        int n = body ? codec_json_decode(body + 4, len - (size_t)(body + 4 - request), device_id, sizeof(device_id),
+                                         records, CODEC_MAX_BATCH) : -1;
+        if (n < 0) status = "400 Bad Request";
+        else self->stats.received += (uint64_t)n;
+    }
+
+    int n = snprintf(response, cap, "HTTP/1.1 %s\r\n%sContent-Length: 0\r\n\r\n", status, retry);
+    *response_len = n > 0 && (size_t)n < cap ? (size_t)n : 0;
+    return 0;
+}
+
+/**
+ * @Brief: Creates the shard's receiver, epoll set and nodes.
+ * @Param: self Pointer to the shard loop being set up.
+ * @Return: 0 on success, -1 on failure.
+ */
+static int shard_setup(struct shard_loop *self)
+{
+    const struct gateway_config *config = &self->shard->gateway->config;
+    struct shard *shard = self->shard;
+
+    self->clock_handle.now_fn = shard_clock_now;
+    self->transport_handle.exchange_fn = shard_http_exchange;
+    self->server_seed = config->seed ^ ((unsigned)shard->id * 2654435761u);
+    self->now      = config->epoch;
+    self->epfd     = -1;
+    self->stats.shard = shard->id;
+
+    if (udp_rx_init(&self->rx, "127.0.0.1", "0") != 0) return -1;
+    udp_rx_set_callback(self->rx, &self->rx_handle, shard_rx_callback);
+
+    self->epfd = epoll_create1(0);
+    if (self->epfd < 0) return -1;
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = self->rx };
+    if (epoll_ctl(self->epfd, EPOLL_CTL_ADD, self->rx->sockfd, &ev) < 0) return -1;
+
+    char port[16];
+    snprintf(port, sizeof(port), "%u", self->rx->port);
+
+    self->nodes = calloc((size_t)shard->n_nodes, sizeof(*self->nodes));
+    if (!self->nodes) return -1;
+
+    for (int i = 0; i < shard->n_nodes; i++)
+    {
+        int node = shard->first_node + i;
+        struct ssn1 *ssn1;
+        int rv = config->http ? ssn1_init(&ssn1) : ssn1_init_udp(&ssn1, "127.0.0.1", port, 0);
+        if (rv != 0) return -1;
+        self->nodes[i] = ssn1;
+        if (config->http)
+        {
+            http_set_transport(ssn1->http_ctx, &self->transport_handle);
+            http_set_transport(ssn1->alert_http_ctx, &self->transport_handle);
+        }
+
+        char device_id[CODEC_DEVICE_ID_MAX];
+        snprintf(device_id, sizeof(device_id), "SSN1-SIM-%05d", node);
+        ssn1_set_device_id(ssn1, device_id);
+        ssn1_set_clock(ssn1, &self->clock_handle);
+        // Jitter seed per node, kept apart from the node's sensor stream
+        ssn1_set_seed(ssn1, (config->seed ^ 0x9e3779b9u) + (unsigned)node * 2654435761u);
+        ssn1_set_report_policy(ssn1, config->deadband, 0);
+        ssn1->low_th_warning  = config->low_th;
+        ssn1->high_th_warning = config->high_th;
+
+        // Every node gets its own source so no generator state is shared between shards
+        struct ssn1_source *source;
+        rv = config->trace
+            ? source_open(&source, config->trace)
+            : source_sim_open_seeded(&source, config->low_th, config->high_th, config->seed + (unsigned)node * 2654435761u);
+        if (rv != 0) return -1;
+        ssn1_set_source(ssn1, source);
+    }
+    return 0;
+}
+
+/**
+ * @Brief: Applies every pending control message.
+ * @Param: self Pointer to the shard loop.
+ * @Return: 1 if a stop was requested, 0 otherwise.
+ */
+static int shard_control(struct shard_loop *self)
+{
+    struct gateway_ctl ctl;
+    int stop = 0;
+    while (ring_pop(self->shard->ctl, &ctl) == 0)
+    {
+        for (int i = 0; i < self->shard->n_nodes; i++)
+        {
+            switch (ctl.type)
+            {
+                case GATEWAY_CTL_THRESHOLDS:
+                    self->nodes[i]->low_th_warning  = ctl.a;
+                    self->nodes[i]->high_th_warning = ctl.b;
+                    break;
+                case GATEWAY_CTL_REPORT_POLICY:
+                    ssn1_set_report_policy(self->nodes[i], ctl.a, (int)ctl.b);
+                    break;
+                case GATEWAY_CTL_STOP:
+                    break;
+            }
+        }
+        if (ctl.type == GATEWAY_CTL_STOP) stop = 1;
+    }
+    return stop;
+}
+
+/**
+ * @Brief: Folds node counters into the shard statistics and pushes them to the gateway.
+ * @Param: self Pointer to the shard loop.
+ * @Param: done Set on the final message.
+ * @Param: start Wall time the loop started at.
+ * @Return: void
+ */
+static void shard_report(struct shard_loop *self, int done, double start)
+{
+    struct gateway_stats *stats = &self->stats;
+    stats->sent       = 0;
+    stats->suppressed = 0;
+    stats->dropped    = 0;
+    for (int i = 0; self->nodes && i < self->shard->n_nodes; i++)
+    {
+        if (!self->nodes[i]) continue;
+        stats->sent       += self->nodes[i]->uploads_sent;
+        stats->suppressed += self->nodes[i]->uploads_suppressed;
+        stats->dropped    += self->nodes[i]->spool_dropped + self->nodes[i]->upload_rejected;
+    }
+    stats->lost    = self->rx ? self->rx->lost : 0;
+    stats->log_idx = self->nodes && self->nodes[0] ? self->nodes[0]->store->log_idx : 0;
+    stats->busy_s  = gateway_seconds() - start;
+    stats->done    = done;
+
+    if (ring_push(self->shard->stats, stats) == 0 || !done) return;
+    // The final message must arrive; the gateway keeps draining while it waits
+    while (ring_push(self->shard->stats, stats) != 0) sched_yield();
+}
+
+/**
+ * @Brief: Shard thread: one virtual second per step, every node worked, receiver drained
+ *         until it has everything the step sent, and the control ring checked between steps.
+ *         In HTTP mode requests are answered inline while the nodes are worked.
+ * @Param: arg Pointer to the shard_t structure.
+ * @Return: NULL
+ */
+static void *shard_main(void *arg)
+{
+    struct shard_loop loop = { .shard = (struct shard *)arg };
+    const struct gateway_config *config = &loop.shard->gateway->config;
+    struct epoll_event events[1];
+
+    int ok = shard_setup(&loop) == 0;
+    if (!ok) LOG("[GATEWAY] Shard %d failed to start\n", loop.shard->id);
+
+    double start = gateway_seconds();
+    for (long step = 0; ok && (config->steps < 0 || step < config->steps); step++)
+    {
+        if (shard_control(&loop)) break;
+
+        int running = 0;
+        loop.now++;
+        for (int i = 0; i < loop.shard->n_nodes; i++)
+        {
+            int rv;
+            struct udp *udp = loop.nodes[i]->udp_ctx;
+            uint32_t seq = udp ? udp->seq : 0;
+            running += !loop.nodes[i]->source_eof;
+            while ((rv = ssn1_work(loop.nodes[i])) != 0)
+            {
+                if (rv == 1) loop.stats.cycles++;
+                else loop.stats.readings++;
+                if (rv == 3) loop.stats.alerts++;
+            }
+            if (udp) loop.sent += (uint32_t)(udp->seq - seq);
+            // Drain as the step goes so a burst of cycle ends never overflows the receive buffer
+            if (loop.sent - loop.rx->received >= GATEWAY_RX_BATCH) udp_rx_work(loop.rx);
+        }
+
+        // Sleep in epoll until this step's datagrams are in; a step that sent nothing makes no syscall.
+        // Whatever the timeout leaves outstanding was lost on the way and is not waited for again.
+        while (loop.rx->received < loop.sent)
+        {
+            if (epoll_wait(loop.epfd, events, 1, GATEWAY_RX_WAIT_MS) <= 0)
+            {
+                loop.sent = loop.rx->received;
+                break;
+            }
+            udp_rx_work(loop.rx);
+        }
+
+        loop.stats.steps = step + 1;
+        if (!running) break;
+        if (loop.stats.steps % GATEWAY_STATS_PERIOD == 0) shard_report(&loop, 0, start);
+    }
+    if (loop.rx) udp_rx_work(loop.rx);
+    shard_report(&loop, 1, start);
+
+    for (int i = 0; loop.nodes && i < loop.shard->n_nodes; i++)
+    {
+        if (loop.nodes[i]) ssn1_dispose(&loop.nodes[i]);
+    }
+    free(loop.nodes);
+    if (loop.epfd >= 0) close(loop.epfd);
+    if (loop.rx) udp_rx_dispose(&loop.rx);
+    return NULL;
+}
+
+/**
+ * @Brief: Allocates a gateway and splits the nodes evenly across its shards.
+ * @Param: self Pointer to the gateway_t pointer to store the allocated structure.
+ * @Param: config Run configuration (copied).
+ * @Return: 0 on success, -1 on failure (invalid configuration or memory allocation error).
+ */
+int gateway_init(struct gateway **self, const struct gateway_config *config)
+{
+    if (config->n_nodes <= 0 || config->n_shards <= 0 || config->n_shards > GATEWAY_MAX_SHARDS) return -1;
+
+    *self = (struct gateway *)calloc(1, sizeof(struct gateway));
+    if (!*self) return -1;
+    (*self)->config = *config;
+    if ((*self)->config.n_shards > config->n_nodes) (*self)->config.n_shards = config->n_nodes;
+
+    long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n_cpus <= 0) n_cpus = 1;
+
+    int n_shards = (*self)->config.n_shards;
+    int first = 0;
+    for (int i = 0; i < n_shards; i++)
+    {
+        struct shard *shard = &(*self)->shards[i];
+        shard->gateway    = *self;
+        shard->id         = i;
+        shard->cpu        = (int)(i % n_cpus);
+        shard->first_node = first;
+        shard->n_nodes    = config->n_nodes / n_shards + (i < config->n_nodes % n_shards);
+        first += shard->n_nodes;
+
+        if (ring_init(&shard->ctl, GATEWAY_RING_SLOTS, sizeof(struct gateway_ctl)) != 0 ||
+            ring_init(&shard->stats, GATEWAY_RING_SLOTS, sizeof(struct gateway_stats)) != 0)
+        {
+            gateway_dispose(self);
+            return -1;
+        }
+        (*self)->latest[i].shard = i;
+    }
+    return 0;
+}
+
+/**
+ * @Brief: Starts one thread per shard, each pinned to its own core before it allocates anything.
+ * @Param: self Pointer to the initialized gateway_t structure.
+ * @Return: 0 on success, -1 if a thread could not be created.
+ */
+int gateway_start(struct gateway *self)
+{
+    for (int i = 0; i < self->config.n_shards; i++)
+    {
+        struct shard *shard = &self->shards[i];
+        pthread_attr_t attr;
+        cpu_set_t cpus;
+
+        pthread_attr_init(&attr);
+        CPU_ZERO(&cpus);
+        CPU_SET(shard->cpu, &cpus);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+
+        int rv = pthread_create(&shard->thread, &attr, shard_main, shard);
+        pthread_attr_destroy(&attr);
+        if (rv != 0)
+        {
+            LOG("[GATEWAY] Failed to start shard %d\n", i);
+            return -1;
+        }
+        self->started++;
+    }
+    return 0;
+}
+
+/**
+ * @Brief: Sends a control message to every shard.
+ * @Param: self Pointer to the initialized gateway_t structure.
+ * @Param: ctl The message to broadcast.
+ * @Return: 0 on success, -1 if a shard's control ring is full.
+ */
+static int gateway_broadcast(struct gateway *self, const struct gateway_ctl *ctl)
+{
+    int rv = 0;
+    for (int i = 0; i < self->config.n_shards; i++)
+    {
+        if (ring_push(self->shards[i].ctl, ctl) != 0) rv = -1;
+    }
+    return rv;
+}
+
+/**
+ * @Brief: Changes the warning thresholds of every node.
+ * @Param: self Pointer to the initialized gateway_t structure.
+ * @Param: low Lower warning threshold.
+ * @Param: high Upper warning threshold.
+ * @Return: 0 on success, -1 if a shard's control ring is full.
+ */
+int gateway_set_thresholds(struct gateway *self, double low, double high)
+{
+    struct gateway_ctl ctl = { GATEWAY_CTL_THRESHOLDS, low, high };
+    return gateway_broadcast(self, &ctl);
+}
+
+/**
+ * @Brief: Changes the report policy of every node (see ssn1_set_report_policy).
+ * @Param: self Pointer to the initialized gateway_t structure.
+ * @Param: deadband Minimum change worth reporting.
+ * @Param: heartbeat Maximum seconds between reports.
+ * @Return: 0 on success, -1 if a shard's control ring is full.
+ */
+int gateway_set_report_policy(struct gateway *self, double deadband, int heartbeat)
+{
+    struct gateway_ctl ctl = { GATEWAY_CTL_REPORT_POLICY, deadband, (double)heartbeat };
+    return gateway_broadcast(self, &ctl);
+}
+
+/**
+ * @Brief: Asks every shard to finish after its current step.
+ * @Param: self Pointer to the initialized gateway_t structure.
+ * @Return: 0 on success, -1 if a shard's control ring is full.
+ */
+int gateway_stop(struct gateway *self)
+{
+    struct gateway_ctl ctl = { GATEWAY_CTL_STOP, 0.0, 0.0 };
+    return gateway_broadcast(self, &ctl);
+}
+
+/**
+ * @Brief: Drains the statistics rings into the per-shard latest values.
+ * @Param: self Pointer to the initialized gateway_t structure.
+ * @Return: Number of shards that have finished.
+ */
+int gateway_poll_stats(struct gateway *self)
+{
+    int done = 0;
+    for (int i = 0; i < self->config.n_shards; i++)
+    {
+        struct gateway_stats stats;
+        while (ring_pop(self->shards[i].stats, &stats) == 0)
+        {
+            self->latest[i] = stats;
+        }
+        done += self->latest[i].done;
+    }
+    return done;
+}
+
+/**
+ * @Brief: Waits for every shard to finish, collecting its final statistics.
+ * @Param: self Pointer to the initialized gateway_t structure.
+ * @Return: 0 on success, -1 if a thread could not be joined.
+ */
+int gateway_join(struct gateway *self)
+{
+    struct timespec nap = { 0, 1000000L };
+    while (gateway_poll_stats(self) < self->started)
+    {
+        nanosleep(&nap, NULL);
+    }
+
+    int rv = 0;
+    for (int i = 0; i < self->started; i++)
+    {
+        if (pthread_join(self->shards[i].thread, NULL) != 0) rv = -1;
+    }
+    self->started = 0;
+    return rv;
+}
+
+/**
+ * @Brief: Sums the latest statistics of every shard. Steps and busy time take the slowest shard.
+ * @Param: self Pointer to the initialized gateway_t structure.
+ * @Param: out Destination totals.
+ * @Return: void
+ */
+void gateway_total(const struct gateway *self, struct gateway_stats *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->shard   = -1;
+    out->done    = 1;
+    out->log_idx = self->latest[0].log_idx;
+    for (int i = 0; i < self->config.n_shards; i++)
+    {
+        const struct gateway_stats *s = &self->latest[i];
+        if (s->steps  > out->steps)  out->steps  = s->steps;
+        if (s->busy_s > out->busy_s) out->busy_s = s->busy_s;
+        out->done       &= s->done;
+        out->readings   += s->readings;
+        out->cycles     += s->cycles;
+        out->alerts     += s->alerts;
+        out->sent       += s->sent;
+        out->suppressed += s->suppressed;
+        out->received   += s->received;
+        out->lost       += s->lost;
+        out->requests   += s->requests;
+        out->throttled  += s->throttled;
+        out->refused    += s->refused;
+        out->dropped    += s->dropped;
+    }
+}
+
+/**
+ * @Brief: Stops and joins any running shards, then frees the rings and the gateway.
+ * @Param: self Pointer to the gateway_t pointer to be disposed and set to NULL.
+ * @Return: 0 on success, -1 if the pointer is invalid.
+ */
+int gateway_dispose(struct gateway **self)
+{
+    if (!self || !*self) return -1;
+    if ((*self)->started)
+    {
+        gateway_stop(*self);
+        gateway_join(*self);
+    }
+    for (int i = 0; i < GATEWAY_MAX_SHARDS; i++)
+    {
+        if ((*self)->shards[i].ctl)   ring_dispose(&(*self)->shards[i].ctl);
+        if ((*self)->shards[i].stats) ring_dispose(&(*self)->shards[i].stats);
+    }
+    free(*self);
+    *self = NULL;
+    return 0;
+}
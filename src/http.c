@@ -1,28 +1,147 @@
+#define _GNU_SOURCE
 #include "http.h"
+#include "log.h"
 #include "tcp.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
 #include <time.h>
+#include <zlib.h>
+
+/**
+ * @Brief: Finds a header in a response head.
+ * @Param: data Start of the response.
+ * @Param: end Start of the blank line that ends the head.
+ * @Param: name Header name without the colon, matched case-insensitively.
+ * @Return: Pointer to the value with leading blanks skipped, NULL if the header is absent.
+ */
+static const char *http_find_header(const char *data, const char *end, const char *name)
+{
+    size_t name_len = strlen(name);
+    const char *line = memmem(data, (size_t)(end - data), "\r\n", 2); // Skip the status line
+    while (line && line < end) 
+    {
+        line += 2;
+        if ((size_t)(end - line) > name_len && strncasecmp(line, name, name_len) == 0 && line[name_len] == ':') 
+        {
+            const char *v = line + name_len + 1;
+            while (v < end && (*v == ' ' || *v == '\t')) v++;
+            return v;
+        }
+        line = memmem(line, (size_t)(end - line), "\r\n", 2);
+    }
+    return NULL;
+}
+
+/**
+ * @Brief: Tells whether a response head declares Transfer-Encoding: chunked.
+ * @Param: data Start of the response.
+ * @Param: end Start of the blank line that ends the head.
+ * @Return: 1 if the body is chunked, 0 otherwise.
+ */
+static int http_is_chunked(const char *data, const char *end)
+{
+    const char *v = http_find_header(data, end, "Transfer-Encoding");
+    for (; v && v + 7 <= end && *v != '\r'; v++) 
+    {
+        if (strncasecmp(v, "chunked", 7) == 0) return 1;
+    }
+    return 0;
+}
+
+/**
+ * @Brief: Walks a chunked body up to its last chunk and trailers, optionally copying the data out.
+ *         out may point at body itself to de-chunk in place.
+ * @Param: body Start of the chunked body.
+ * @Param: len Bytes available.
+ * @Param: out Destination for the chunk data, NULL to only measure.
+ * @Param: out_len Destination for the length of the chunk data, may be NULL.
+ * @Return: Length of the complete chunked body, 0 while more bytes are needed or if it is malformed.
+ */
+static size_t http_chunked_length(const char *body, size_t len, char *out, size_t *out_len)
+{
+    size_t pos = 0, n = 0;
+    while (1) 
+    {
+        const char *eol = memmem(body + pos, len - pos, "\r\n", 2);
+        if (!eol) return 0;
+        char *digits_end;
+        unsigned long size = strtoul(body + pos, &digits_end, 16);
+        if (digits_end == body + pos) return 0;
+        pos = (size_t)(eol - body) + 2;
+
+        if (size == 0) 
+        {
+            // Trailers, if any, end with an empty line
+            while (1) 
+            {
+                const char *t = memmem(body + pos, len - pos, "\r\n", 2);
+                if (!t) return 0;
+                size_t line_len = (size_t)(t - (body + pos));
+                pos += line_len + 2;
+                if (line_len == 0) break;
+            }
+            if (out_len) *out_len = n;
+            return pos;
+        }
+
+        if (size > len - pos || len - pos - size < 2) return 0;
+        if (out) memmove(out + n, body + pos, size);
+        n   += size;
+        pos += size + 2;
+    }
+}
+
+/**
+ * @Brief: Tells whether a failed request may succeed if sent again unchanged.
+ * @Param: status HTTP status code, 0 if the response could not be parsed.
+ * @Return: 1 for 408, 429, 5xx and unparsable responses, 0 for other statuses.
+ */
+int http_status_transient(int status)
+{
+    return status == 0 || status == 408 || status == 429 || status >= 500;
+}
 
 /**
  * @Brief: Callback function executed by the underlying TCP layer when a response is received.
  * @Param: cb_handle Pointer to the embedded tcp_cb structure.
  * @Param: response The raw TCP response data buffer.
  * @Param: len The length of the response data.
- * @Return: 0 on success.
+ * @Return: 0 for a 2xx response, -1 otherwise so the TCP retry policy backs off a server that answers
+ *          with errors just like one that cannot be reached. The response is delivered either way.
  */
 static int http_tcp_callback(struct tcp_cb *cb_handle, const char *response, size_t len)
 {
     struct http *self = CONTAINER_OF(cb_handle, struct http, tcp_handle);
-    printf("[HTTP] Received TCP response (%zu bytes)\n", len);
+    LOG("[HTTP] Received TCP response (%zu bytes)\n", len);
     // Copy the response, ensuring null termination and boundary check.
     size_t copy_len = len < sizeof(self->response) - 1 ? len : sizeof(self->response) - 1;
     memcpy(self->response, response, copy_len);
     self->response[copy_len] = '\0';
+
+    // De-chunk the body in place so callers see it as if it had a Content-Length
+    const char *head_end = memmem(self->response, copy_len, "\r\n\r\n", 4);
+    if (head_end && http_is_chunked(self->response, head_end)) 
+    {
+        char *body = self->response + (head_end - self->response) + 4;
+        size_t body_len = 0;
+        if (http_chunked_length(body, copy_len - (size_t)(body - self->response), body, &body_len) > 0) 
+        {
+            body[body_len] = '\0';
+        }
+    }
     // Move HTTP state to complete, signaling that the response is ready.
     self->state = HTTP_STATE_COMPLETE;
     
+    // Only a transient failure counts against the link: a server that answers 4xx is reachable
+    int status = 0;
+    if (sscanf(self->response, "HTTP/%*d.%*d %d", &status) != 1) status = 0;
+    if (status < 200 || status >= 300) 
+    {
+        LOG("[HTTP] Request failed with status %d\n", status);
+        if (http_status_transient(status)) return -1;
+    }
     return 0;
 }
 
@@ -40,15 +159,18 @@ int http_init(struct http **self, const char *host, const char *port)
     
     (*self)->host = strdup(host);
     (*self)->port = strdup(port);
+    (*self)->body = malloc(HTTP_BODY_MAX);
     (*self)->state = HTTP_STATE_IDLE;
+    (*self)->format = CODEC_FORMAT_JSON;
     
     // Initialize the underlying TCP context
     struct tcp *tcp;
-    if (tcp_init(&tcp, host, port) != 0) 
+    if (!(*self)->body || tcp_init(&tcp, host, port) != 0) 
     {
-        printf("[HTTP] Failed to initialize TCP\n");
+        LOG("[HTTP] Failed to initialize TCP\n");
         free((*self)->host);
         free((*self)->port);
+        free((*self)->body);
         free(*self);
         *self = NULL;
         return -1;
@@ -60,7 +182,7 @@ int http_init(struct http **self, const char *host, const char *port)
     (*self)->tcp_handle.cb_fn = http_tcp_callback;
     tcp_set_callback(tcp, &(*self)->tcp_handle, http_tcp_callback);
     
-    printf("[HTTP] Initialized for %s:%s\n", host, port);
+    LOG("[HTTP] Initialized for %s:%s\n", host, port);
     return 0;
 }
 
@@ -79,80 +201,390 @@ void http_set_callback(struct http *self, struct http_cb *cb_handle, http_cb_fn
 }
 
 /**
- * @Brief: Constructs an HTTP POST request with sensor data encoded as JSON and queues it for transmission via TCP.
+ * @Brief: Selects the body encoding used for subsequent uploads.
  * @Param: self Pointer to the initialized http_t structure.
- * @Param: device_id A unique identifier for the sensor.
- * @Param: timestamp The time of the reading.
- * @Param: temperature The measured temperature value.
- * @Param: threshold_flag Flag indicating if a warning threshold was breached (0 or 1).
- * @Return: 0 on successful queuing, -1 on failure (not IDLE, JSON/HTTP formatting error, or TCP queue failure).
+ * @Param: format CODEC_FORMAT_JSON (default) or CODEC_FORMAT_BINARY.
+ * @Return: void
  */
-int http_send_temp_data(struct http *self, const char *device_id,
-                         time_t timestamp, double temperature, int threshold_flag)
+void http_set_format(struct http *self, codec_format_t format)
 {
-    if (!self || self->state != HTTP_STATE_IDLE) 
+    if (!self || format == CODEC_FORMAT_UNKNOWN) return;
+    self->format = format;
+}
+
+/**
+ * @Brief: Frames a response on a persistent connection: headers up to the blank line plus a body delimited by
+ *         Content-Length or chunked transfer encoding. A response with neither runs until the server closes
+ *         the connection, which then cannot be reused.
+ * @Param: data Bytes received so far.
+ * @Param: len Number of bytes received.
+ * @Return: Length of the complete response, 0 while more bytes are needed (or until the server closes).
+ */
+size_t http_response_length(const char *data, size_t len)
+{
+    const char *end = memmem(data, len, "\r\n\r\n", 4);
+    if (!end) return 0;
+    size_t hdr_len = (size_t)(end - data) + 4;
+
+    // These never carry a body, whatever the headers say
+    int status = 0;
+    sscanf(data, "HTTP/%*d.%*d %d", &status);
+    if (status == 204 || status == 304) return hdr_len;
+
+    if (http_is_chunked(data, end)) 
+    {
+        size_t body_len = http_chunked_length(data + hdr_len, len - hdr_len, NULL, NULL);
+        return body_len ? hdr_len + body_len : 0;
+    }
+
+    const char *length = http_find_header(data, end, "Content-Length");
+    if (!length) return 0;
+    size_t body_len = strtoul(length, NULL, 10);
+    return len >= hdr_len + body_len ? hdr_len + body_len : 0;
+}
+
+/**
+ * @Brief: Keeps the connection to the server open between uploads instead of reconnecting for each one.
+ * @Param: self Pointer to the initialized http_t structure.
+ * @Param: enable Non-zero for persistent connections.
+ * @Return: void
+ */
+void http_set_keep_alive(struct http *self, int enable)
+{
+    if (!self) return;
+    self->keep_alive = enable ? 1 : 0;
+    tcp_set_keep_alive(self->tcp_ctx, enable ? http_response_length : NULL);
+}
+
+/**
+ * @Brief: Seeds the retry jitter of the client's connection (see tcp_set_seed()).
+ * @Param: self Pointer to the initialized http_t structure.
+ * @Param: seed The seed.
+ * @Return: void
+ */
+void http_set_seed(struct http *self, unsigned int seed)
+{
+    if (!self) return;
+    tcp_set_seed(self->tcp_ctx, seed);
+}
+
+/**
+ * @Brief: Runs the retry policy of the client's connection on another clock (see tcp_set_clock()).
+ * @Param: self Pointer to the initialized http_t structure.
+ * @Param: clock Pointer to an embedded tcp_clock structure, NULL for CLOCK_MONOTONIC.
+ * @Return: void
+ */
+void http_set_clock(struct http *self, struct tcp_clock *clock)
+{
+    if (!self) return;
+    tcp_set_clock(self->tcp_ctx, clock);
+}
+
+/**
+ * @Brief: Sends the client's requests through an in-memory transport (see tcp_set_transport()).
+ * @Param: self Pointer to the initialized http_t structure.
+ * @Param: transport Pointer to an embedded tcp_transport structure, NULL for real sockets.
+ * @Return: void
+ */
+void http_set_transport(struct http *self, struct tcp_transport *transport)
+{
+    if (!self) return;
+    tcp_set_transport(self->tcp_ctx, transport);
+}
+
+/**
+ * @Brief: Enables compression of upload bodies of at least min_size bytes. The deflate stream is created
+ *         once here and only reset for each request.
+ * @Param: self Pointer to the initialized http_t structure.
+ * @Param: encoding HTTP_ENCODING_DEFLATE, HTTP_ENCODING_GZIP, or HTTP_ENCODING_IDENTITY to turn it off.
+ * @Param: min_size Smallest body worth compressing (0 selects HTTP_ENCODE_MIN_DEFAULT).
+ * @Param: level zlib compression level 1..9, or Z_DEFAULT_COMPRESSION (-1).
+ * @Return: 0 on success, -1 on failure (memory or zlib error; the client is left uncompressed).
+ */
+int http_set_encoding(struct http *self, http_encoding_t encoding, size_t min_size, int level)
+{
+    if (!self) return -1;
+    if (self->zstream) 
+    {
+        deflateEnd(self->zstream);
+        free(self->zstream);
+        self->zstream = NULL;
+    }
+    free(self->packed);
+    self->packed     = NULL;
+    self->encoding   = HTTP_ENCODING_IDENTITY;
+    self->encode_min = min_size ? min_size : HTTP_ENCODE_MIN_DEFAULT;
+    if (encoding == HTTP_ENCODING_IDENTITY) return 0;
+
+    self->packed  = malloc(HTTP_BODY_MAX);
+    self->zstream = calloc(1, sizeof(z_stream));
+    if (!self->packed || !self->zstream) 
     {
-        printf("[HTTP] Cannot send - not in IDLE state (current: %d)\n", self->state);
+        free(self->packed);
+        free(self->zstream);
+        self->packed  = NULL;
+        self->zstream = NULL;
         return -1;
     }
-    
-    struct tcp *tcp = (struct tcp *)self->tcp_ctx;
-    
-    // Format timestamp
-    char time_str[64];
-    struct tm *tm_info = localtime(&timestamp);
-    strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", tm_info);
-    
-    // Build JSON body
-    char json_body[512];
-    int json_len = snprintf(json_body, sizeof(json_body),
-        "{\n"
-        "  \"device\": \"%s\",\n"
-        "  \"time\": \"%s\",\n"
-        "  \"temperature\": \"%.2f°C\",\n"
-        "  \"threshold_broken\": \"%d\"\n"
-        "}",
-        device_id, time_str, temperature, threshold_flag);
-    
-    if (json_len < 0 || json_len >= (int)sizeof(json_body)) 
+    // windowBits 15 gives the zlib wrapper, +16 the gzip wrapper
+    int window_bits = encoding == HTTP_ENCODING_GZIP ? 15 + 16 : 15;
+    if (deflateInit2(self->zstream, level, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK) 
     {
-        printf("[HTTP] Failed to format JSON\n");
+        LOG("[HTTP] Failed to set up compression\n");
+        free(self->packed);
+        free(self->zstream);
+        self->packed  = NULL;
+        self->zstream = NULL;
         return -1;
     }
-    
-    printf("[HTTP] JSON body:\n%s\n", json_body);
-    
-    // Build full HTTP request header + body
-    char http_request[2048];
-    int req_len = snprintf(http_request, sizeof(http_request),
+    self->encoding = encoding;
+    return 0;
+}
+
+/**
+ * @Brief: Compresses a body with the client's deflate stream.
+ * @Param: self Pointer to an http_t structure with compression enabled.
+ * @Param: in The body to compress.
+ * @Param: in_len Length of the body.
+ * @Param: out Destination buffer.
+ * @Param: out_cap Size of the destination buffer.
+ * @Return: Compressed length, -1 if compression is off, failed or did not fit.
+ */
+int http_deflate(struct http *self, const void *in, size_t in_len, void *out, size_t out_cap)
+{
+    if (!self || !self->zstream) return -1;
+    z_stream *z = self->zstream;
+
+    deflateReset(z);
+    z->next_in   = (Bytef *)in;
+    z->avail_in  = (uInt)in_len;
+    z->next_out  = (Bytef *)out;
+    z->avail_out = (uInt)out_cap;
+    if (deflate(z, Z_FINISH) != Z_STREAM_END) return -1;
+    return (int)(out_cap - z->avail_out);
+}
+
+/**
+ * @Brief: Reports whether a new upload can be started now (idle and allowed by the TCP retry policy).
+ * @Param: self Pointer to the initialized http_t structure.
+ * @Return: 1 if a send would be accepted, 0 otherwise.
+ */
+int http_ready(struct http *self)
+{
+    if (!self || self->state != HTTP_STATE_IDLE) return 0;
+    return tcp_ready(self->tcp_ctx);
+}
+
+/**
+ * @Brief: Returns the circuit breaker state of the underlying connection.
+ * @Param: self Pointer to the initialized http_t structure.
+ * @Return: The current tcp_link_t state.
+ */
+tcp_link_t http_link_state(const struct http *self)
+{
+    if (!self) return TCP_LINK_OPEN;
+    return tcp_link_state(self->tcp_ctx);
+}
+
+/**
+ * @Brief: Builds a POST /post request around an already encoded body and queues it for transmission via TCP.
+ * @Param: self Pointer to the initialized http_t structure.
+ * @Param: content_type The Content-Type header value describing the body.
+ * @Param: content_encoding The Content-Encoding header value, NULL for an unencoded body.
+ * @Param: body The encoded request body (may contain binary data).
+ * @Param: body_len Length of the body in bytes.
+ * @Return: 0 on successful queuing, -1 on failure (formatting, memory or TCP queue failure).
+ */
+static int http_post(struct http *self, const char *content_type, const char *content_encoding,
+                     const void *body, size_t body_len)
+{
+    struct tcp *tcp = (struct tcp *)self->tcp_ctx;
+
+    // Build the HTTP request header
+    char header[512];
+    int hdr_len = snprintf(header, sizeof(header),
         "POST /post HTTP/1.1\r\n"
         "Host: %s\r\n"
-        "Content-Type: application/json\r\n"
-        "Content-Length: %d\r\n"
-        "Connection: close\r\n"
-        "\r\n"
-        "%s",
-        self->host, json_len, json_body);
-    
-    if (req_len < 0 || req_len >= (int)sizeof(http_request)) 
+        "Content-Type: %s\r\n"
+        "%s%s%s"
+        "Content-Length: %zu\r\n"
+        "Connection: %s\r\n"
+        "\r\n",
+        self->host, content_type,
+        content_encoding ? "Content-Encoding: " : "", content_encoding ? content_encoding : "", content_encoding ? "\r\n" : "",
+        body_len, self->keep_alive ? "keep-alive" : "close");
+
+    if (hdr_len < 0 || hdr_len >= (int)sizeof(header)) 
     {
-        printf("[HTTP] Failed to build HTTP request\n");
+        LOG("[HTTP] Failed to build HTTP request\n");
         return -1;
     }
-    
-    printf("[HTTP] Sending POST request (%d bytes)\n", req_len);
-    
+
+    // Header and body are joined with memcpy since a binary body may contain NUL bytes
+    size_t req_len = (size_t)hdr_len + body_len;
+    char *http_request = malloc(req_len);
+    if (!http_request) 
+    {
+        LOG("[HTTP] Failed to allocate request buffer\n");
+        return -1;
+    }
+    memcpy(http_request, header, (size_t)hdr_len);
+    memcpy(http_request + hdr_len, body, body_len);
+
+    LOG("[HTTP] Sending POST request (%zu bytes)\n", req_len);
+
     // Queue the raw request data for the TCP client
-    if (tcp_send_request(tcp, http_request, req_len) != 0) 
+    int rv = tcp_send_request(tcp, http_request, req_len);
+    free(http_request);
+    if (rv != 0) 
     {
-        printf("[HTTP] Failed to queue TCP request\n");
+        LOG("[HTTP] Failed to queue TCP request\n");
         return -1;
     }
-    
+
     self->state = HTTP_STATE_PROCESSING;
     return 0;
 }
 
+/**
+ * @Brief: Encodes a batch of sensor records in the selected format and queues it as one HTTP POST request.
+ * @Param: self Pointer to the initialized http_t structure.
+ * @Param: device_id A unique identifier for the sensor.
+ * @Param: records Array of records to send.
+ * @Param: count Number of records (1..CODEC_MAX_BATCH).
+ * @Return: 0 on successful queuing, -1 on failure (not IDLE, encoding error, or TCP queue failure).
+ */
+int http_send_temp_batch(struct http *self, const char *device_id,
+                         const struct temp_record *records, size_t count)
+{
+    if (!self || self->state != HTTP_STATE_IDLE) 
+    {
+        LOG("[HTTP] Cannot send - not in IDLE state (current: %d)\n", self ? (int)self->state : -1);
+        return -1;
+    }
+
+    char *body = self->body;
+    int body_len;
+
+    if (self->format == CODEC_FORMAT_BINARY)
+    {
+        body_len = codec_bin_encode((uint8_t *)body, HTTP_BODY_MAX, device_id, records, count);
+        if (body_len < 0)
+        {
+            LOG("[HTTP] Failed to encode binary body\n");
+            return -1;
+        }
+        LOG("[HTTP] Binary body: %zu record(s), %d bytes\n", count, body_len);
+    }
+    else
+    {
+        body_len = codec_json_encode(body, HTTP_BODY_MAX, device_id, records, count);
+        if (body_len < 0) 
+        {
+            LOG("[HTTP] Failed to format JSON\n");
+            return -1;
+        }
+        LOG("[HTTP] JSON body:\n%s\n", body);
+    }
+
+    self->bytes_raw += (uint64_t)body_len;
+
+    // Large bodies (batches) are compressed when an encoding is set and it actually saves bytes
+    if (self->zstream && (size_t)body_len >= self->encode_min) 
+    {
+        char *packed = self->packed;
+        int packed_len = http_deflate(self, body, (size_t)body_len, packed, HTTP_BODY_MAX);
+        if (packed_len > 0 && packed_len < body_len) 
+        {
+            LOG("[HTTP] Body compressed %d -> %d bytes\n", body_len, packed_len);
+            self->bytes_encoded += (uint64_t)packed_len;
+            return http_post(self, codec_content_type(self->format),
+                             self->encoding == HTTP_ENCODING_GZIP ? "gzip" : "deflate", packed, (size_t)packed_len);
+        }
+    }
+
+    self->bytes_encoded += (uint64_t)body_len;
+    return http_post(self, codec_content_type(self->format), NULL, body, (size_t)body_len);
+}
+
+/**
+ * @Brief: Constructs an HTTP POST request with a single sensor reading and queues it for transmission via TCP.
+ * @Param: self Pointer to the initialized http_t structure.
+ * @Param: device_id A unique identifier for the sensor.
+ * @Param: timestamp The time of the reading.
+ * @Param: temperature The measured temperature value.
+ * @Param: threshold_flag Flag indicating if a warning threshold was breached (0 or 1).
+ * @Return: 0 on successful queuing, -1 on failure (not IDLE, encoding error, or TCP queue failure).
+ */
+int http_send_temp_data(struct http *self, const char *device_id,
+                         time_t timestamp, double temperature, int threshold_flag)
+{
+    struct temp_record record = 
+    {
+        .timestamp      = timestamp,
+        .temperature    = temperature,
+        .threshold_flag = threshold_flag
+    };
+    return http_send_temp_batch(self, device_id, &record, 1);
+}
+
+/**
+ * @Brief: Parses a Retry-After value, either delay-seconds or an HTTP-date.
+ * @Param: value The header value (leading whitespace allowed).
+ * @Param: now The current time an HTTP-date is measured against.
+ * @Return: Seconds to wait (0 for a date in the past), -1 if the value does not parse.
+ */
+static long http_parse_retry_after(const char *value, time_t now)
+{
+    while (*value == ' ' || *value == '\t') value++;
+
+    char *end;
+    long seconds = strtol(value, &end, 10);
+    if (end != value && (*end == '\r' || *end == '\n' || *end == '\0' || *end == ' ')) 
+    {
+        return seconds < 0 ? -1 : seconds;
+    }
+
+    // HTTP-date, e.g. "Fri, 31 Dec 1999 23:59:59 GMT"
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    if (!strptime(value, "%a, %d %b %Y %H:%M:%S GMT", &tm)) return -1;
+    long delta = (long)(timegm(&tm) - now);
+    return delta > 0 ? delta : 0;
+}
+
+/**
+ * @Brief: Splits a raw response into status code, Retry-After and body.
+ * @Param: response The NUL-terminated raw response.
+ * @Param: now The current time, so a Retry-After date becomes a delay on the caller's clock.
+ * @Param: out Destination; body points into response.
+ * @Return: 0 on success, -1 if there is no valid status line.
+ */
+int http_parse_response(const char *response, time_t now, struct http_response *out)
+{
+    out->status      = 0;
+    out->retry_after = -1;
+    out->body        = "";
+    if (!response || sscanf(response, "HTTP/%*d.%*d %d", &out->status) != 1) return -1;
+
+    const char *line = strstr(response, "\r\n");
+    while (line) 
+    {
+        line += 2;
+        if (line[0] == '\r' && line[1] == '\n') 
+        {
+            out->body = line + 2;
+            break;
+        }
+        if (strncasecmp(line, "Retry-After:", 12) == 0) 
+        {
+            out->retry_after = http_parse_retry_after(line + 12, now);
+        }
+        line = strstr(line, "\r\n");
+    }
+    return 0;
+}
+
 /**
  * @Brief: The main state machine worker for the HTTP client. It drives the underlying TCP state machine.
  * @Param: self Pointer to the initialized http_t structure.
@@ -174,8 +606,10 @@ int http_work(struct http *self)
                 int result = tcp_work(tcp); // Drive TCP state
                 if (result < 0) 
                 {
-                    printf("[HTTP] TCP error\n");
-                    self->state = HTTP_STATE_ERROR;
+                    LOG("[HTTP] TCP error\n");
+                    // Let TCP clean up its error state now so both layers are reusable right away
+                    tcp_work(tcp);
+                    self->state = HTTP_STATE_IDLE;
                     return -1;
                 }
             }
@@ -211,10 +645,17 @@ int http_dispose(struct http **self)
     {
         tcp_dispose((struct tcp **)&(*self)->tcp_ctx);
     }
+    if ((*self)->zstream) 
+    {
+        deflateEnd((*self)->zstream);
+        free((*self)->zstream);
+    }
+    free((*self)->body);
+    free((*self)->packed);
     if ((*self)->host) free((*self)->host);
     if ((*self)->port) free((*self)->port);
     free(*self);
     *self = NULL;
-    printf("[HTTP] Disposed\n");
+    LOG("[HTTP] Disposed\n");
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,1018 @@
+#define _GNU_SOURCE
+#include "ingest.h"
+#include "log.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sched.h>
+#include <time.h>
+#include <zlib.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+// One client connection. Requests are parsed straight out of the worker's scratch buffer; a connection
+// only holds memory of its own while a request is split across reads or a response is waiting on a full socket.
+struct ingest_conn
+{
+    int fd;
+    int close_after;       // Close once the pending response is out (Connection: close, fatal error)
+    char *in;              // Partial request carried over between reads, NULL when none
+    size_t in_len;
+    size_t in_cap;
+    char *out;             // Response bytes the socket did not take yet, NULL when none
+    size_t out_len;
+    size_t out_sent;
+    struct ingest_conn *prev;
+    struct ingest_conn *next;
+};
+
+// Column block being filled for one device
+struct ingest_device
+{
+    char id[CODEC_DEVICE_ID_MAX];
+    uint32_t rows;
+    int dirty;
+    struct ingest_device *next_dirty;
+    int64_t timestamp[INGEST_BLOCK_ROWS];
+    double  temperature[INGEST_BLOCK_ROWS];
+    float   min[INGEST_BLOCK_ROWS];
+    float   max[INGEST_BLOCK_ROWS];
+    float   stddev[INGEST_BLOCK_ROWS];
+    float   p95[INGEST_BLOCK_ROWS];
+    uint8_t threshold_flag[INGEST_BLOCK_ROWS];
+};
+
+// Everything below is private to one worker thread
+struct ingest_loop
+{
+    struct ingest_worker *worker;
+    struct ingest_stats stats;
+    struct ingest_conn *conns;
+    struct ingest_device **devices;     // Open-addressing table keyed by device id
+    size_t devices_cap;
+    size_t n_devices;
+    struct ingest_device *dirty;        // Devices with a partly filled block
+    struct temp_record records[CODEC_MAX_BATCH];
+    z_stream zstream;                   // Inflates deflate/gzip bodies, reset per request
+    int zstream_ready;
+    char inflated[INGEST_SCRATCH];
+    char out[INGEST_SCRATCH];           // Responses produced while handling one read
+    size_t out_len;
+    char scratch[INGEST_SCRATCH];
+};
+
+/**
+ * @Brief: Returns CLOCK_MONOTONIC time in milliseconds.
+ * @Return: Milliseconds.
+ */
+static long long ingest_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @Brief: Sets a socket file descriptor to non-blocking mode.
+ * @Param: fd The socket file descriptor to modify.
+ * @Return: 0 on success, -1 on failure.
+ */
+static int ingest_set_nonblocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0) return -1;
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+/**
+ * @Brief: Hashes a device id (FNV-1a).
+ * @Param: id NUL-terminated device id.
+ * @Return: The hash.
+ */
+static uint32_t ingest_hash(const char *id)
+{
+    uint32_t h = 2166136261u;
+    for (; *id; id++)
+    {
+        h ^= (uint8_t)*id;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/**
+ * @Brief: Writes a device's buffered rows as one block at the end of its column file. On failure the
+ *         rows stay buffered for the next flush and any partial block is cut off again, so the file
+ *         keeps its framing.
+ * @Param: loop Pointer to the worker loop.
+ * @Param: dev The device to flush.
+ * @Return: 0 on success, -1 if the block could not be written.
+ */
+static int ingest_flush_device(struct ingest_loop *loop, struct ingest_device *dev)
+{
+    if (dev->rows == 0) return 0;
+
+    // [A-Za-z0-9._-] reach the file name as is, every other byte (and a leading dot) as %XX, so two
+    // different ids never share a file
+    static const char hex[] = "0123456789ABCDEF";
+    char name[CODEC_DEVICE_ID_MAX * 3];
+    size_t n = 0;
+    for (size_t i = 0; dev->id[i]; i++)
+    {
+        unsigned char c = (unsigned char)dev->id[i];
+        int safe = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '_' || c == '.';
+        if (safe && !(i == 0 && c == '.'))
+        {
+            name[n++] = (char)c;
+        }
+        else
+        {
+            name[n++] = '%';
+            name[n++] = hex[c >> 4];
+            name[n++] = hex[c & 0xF];
+        }
+    }
+    name[n] = '\0';
+
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s.col", loop->worker->ingest->dir, name);
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        LOG("[INGEST] Failed to open %s: %s\n", path, strerror(errno));
+        loop->stats.errors++;
+        return -1;
+    }
+
+    uint32_t rows = dev->rows;
+    struct ingest_col_header header = { INGEST_COL_MAGIC, rows };
+    struct iovec iov[8] =
+    {
+        { &header,             sizeof(header) },
+        { dev->timestamp,      rows * sizeof(dev->timestamp[0]) },
+        { dev->temperature,    rows * sizeof(dev->temperature[0]) },
+        { dev->min,            rows * sizeof(dev->min[0]) },
+        { dev->max,            rows * sizeof(dev->max[0]) },
+        { dev->stddev,         rows * sizeof(dev->stddev[0]) },
+        { dev->p95,            rows * sizeof(dev->p95[0]) },
+        { dev->threshold_flag, rows * sizeof(dev->threshold_flag[0]) },
+    };
+
+    // A regular file only comes back short on a full disk, a size limit or a signal; carry on from
+    // where it stopped until the block is complete or the write fails
+    struct iovec *v = iov;
+    int v_count = 8;
+    size_t written = 0;
+    off_t start = -1;
+    int rv = 0;
+    while (v_count > 0)
+    {
+        ssize_t n = writev(fd, v, v_count);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0)
+        {
+            LOG("[INGEST] Failed to write %s: %s\n", path, n < 0 ? strerror(errno) : "no progress");
+            rv = -1;
+            break;
+        }
+        if (written == 0) start = lseek(fd, 0, SEEK_CUR) - n;
+        written += (size_t)n;
+        while (v_count > 0 && (size_t)n >= v->iov_len)
+        {
+            n -= (ssize_t)v->iov_len;
+            v++;
+            v_count--;
+        }
+        if (v_count > 0)
+        {
+            v->iov_base = (char *)v->iov_base + n;
+            v->iov_len -= (size_t)n;
+        }
+    }
+
+    if (rv == 0)
+    {
+        loop->stats.blocks++;
+        dev->rows = 0;
+    }
+    else
+    {
+        // Cut the partial block off again, unless another worker has appended after it meanwhile
+        struct stat st;
+        if (written > 0 && start >= 0 && fstat(fd, &st) == 0 && st.st_size == start + (off_t)written)
+        {
+            if (ftruncate(fd, start) != 0) LOG("[INGEST] Failed to truncate %s: %s\n", path, strerror(errno));
+        }
+        loop->stats.errors++;
+    }
+    close(fd);
+    return rv;
+}
+
+/**
+ * @Brief: Writes out every partly filled block. Devices whose block could not be written stay on the
+ *         dirty list and are retried on the next flush.
+ * @Param: loop Pointer to the worker loop.
+ * @Return: void
+ */
+static void ingest_flush_dirty(struct ingest_loop *loop)
+{
+    struct ingest_device *failed = NULL;
+    while (loop->dirty)
+    {
+        struct ingest_device *dev = loop->dirty;
+        loop->dirty = dev->next_dirty;
+        if (ingest_flush_device(loop, dev) == 0)
+        {
+            dev->next_dirty = NULL;
+            dev->dirty = 0;
+        }
+        else
+        {
+            dev->next_dirty = failed;
+            failed = dev;
+        }
+    }
+    loop->dirty = failed;
+}
+
+/**
+ * @Brief: Finds or creates the column buffer of a device.
+ * @Param: loop Pointer to the worker loop.
+ * @Param: id NUL-terminated device id.
+ * @Return: The device, NULL on memory allocation failure.
+ */
+static struct ingest_device *ingest_device(struct ingest_loop *loop, const char *id)
+{
+    if ((loop->n_devices + 1) * 2 > loop->devices_cap)
+    {
+        size_t cap = loop->devices_cap ? loop->devices_cap * 2 : 1024;
+        struct ingest_device **table = calloc(cap, sizeof(*table));
+        if (!table) return NULL;
+        for (size_t i = 0; i < loop->devices_cap; i++)
+        {
+            struct ingest_device *dev = loop->devices[i];
+            if (!dev) continue;
+            size_t slot = ingest_hash(dev->id) & (cap - 1);
+            while (table[slot]) slot = (slot + 1) & (cap - 1);
+            table[slot] = dev;
+        }
+        free(loop->devices);
+        loop->devices     = table;
+        loop->devices_cap = cap;
+    }
+
+    size_t mask = loop->devices_cap - 1;
+    size_t slot = ingest_hash(id) & mask;
+    while (loop->devices[slot])
+    {
+        if (strcmp(loop->devices[slot]->id, id) == 0) return loop->devices[slot];
+        slot = (slot + 1) & mask;
+    }
+
+    struct ingest_device *dev = calloc(1, sizeof(*dev));
+    if (!dev) return NULL;
+    snprintf(dev->id, sizeof(dev->id), "%s", id);
+    loop->devices[slot] = dev;
+    loop->n_devices++;
+    return dev;
+}
+
+/**
+ * @Brief: Appends decoded records to the device's column block, writing it out when full. A batch is
+ *         taken whole or not at all: when the block has no room and cannot be written out first,
+ *         nothing is stored and the client is expected to retry.
+ * @Param: loop Pointer to the worker loop.
+ * @Param: id NUL-terminated device id.
+ * @Param: records The records to store (at most INGEST_BLOCK_ROWS).
+ * @Param: count Number of records.
+ * @Return: 0 on success, -1 on memory allocation failure or if the block could not be written.
+ */
+static int ingest_store(struct ingest_loop *loop, const char *id, const struct temp_record *records, int count)
+{
+    struct ingest_device *dev = ingest_device(loop, id);
+    if (!dev) return -1;
+    if (dev->rows + (uint32_t)count > INGEST_BLOCK_ROWS && ingest_flush_device(loop, dev) != 0) return -1;
+
+    for (int i = 0; i < count; i++)
+    {
+        const struct temp_record *r = &records[i];
+        uint32_t row = dev->rows++;
+        dev->timestamp[row]      = (int64_t)r->timestamp;
+        dev->temperature[row]    = r->temperature;
+        dev->min[row]            = r->has_stats ? r->min : NAN;
+        dev->max[row]            = r->has_stats ? r->max : NAN;
+        dev->stddev[row]         = r->has_stats ? r->stddev : NAN;
+        dev->p95[row]            = r->has_stats ? r->p95 : NAN;
+        dev->threshold_flag[row] = (uint8_t)r->threshold_flag;
+    }
+    // A full block that fails to go out stays buffered (and dirty) for the next flush
+    if (dev->rows == INGEST_BLOCK_ROWS) ingest_flush_device(loop, dev);
+
+    if (dev->rows > 0 && !dev->dirty)
+    {
+        dev->dirty      = 1;
+        dev->next_dirty = loop->dirty;
+        loop->dirty     = dev;
+    }
+    return 0;
+}
+
+/**
+ * @Brief: Queues a response in the worker's output buffer.
+ * @Param: loop Pointer to the worker loop.
+ * @Param: conn The connection being answered.
+ * @Param: status HTTP status code.
+ * @Param: reason Reason phrase.
+ * @Param: body JSON response body.
+ * @Return: void
+ */
+static void ingest_respond(struct ingest_loop *loop, struct ingest_conn *conn, int status, const char *reason, const char *body)
+{
+    int len = snprintf(loop->out + loop->out_len, sizeof(loop->out) - loop->out_len,
+        "HTTP/1.1 %d %s\r\n"
+        "Content-Type: application/json\r\n"
+        "Content-Length: %zu\r\n"
+        "Connection: %s\r\n"
+        "\r\n"
+        "%s",
+        status, reason, strlen(body), conn->close_after ? "close" : "keep-alive", body);
+    if (len > 0 && (size_t)len < sizeof(loop->out) - loop->out_len) loop->out_len += (size_t)len;
+    if (status >= 400) loop->stats.errors++;
+}
+
+static void ingest_decode(struct ingest_loop *loop, struct ingest_conn *conn, const char *content_type,
+                          size_t content_type_len, const char *body, size_t body_len);
+
+/**
+ * @Brief: Parses a Content-Length value: digits only, surrounded by optional blanks, without overflow.
+ * @Param: v First byte after the colon.
+ * @Param: eol End of the header line.
+ * @Param: out Destination length.
+ * @Return: 0 on success, -1 if the value is not a valid length.
+ */
+static int ingest_parse_length(const char *v, const char *eol, size_t *out)
+{
+    while (v < eol && (*v == ' ' || *v == '\t')) v++;
+    size_t n = 0;
+    const char *digits = v;
+    for (; v < eol && *v >= '0' && *v <= '9'; v++)
+    {
+        size_t d = (size_t)(*v - '0');
+        if (n > (SIZE_MAX - d) / 10) return -1;
+        n = n * 10 + d;
+    }
+    if (v == digits) return -1;
+    while (v < eol && (*v == ' ' || *v == '\t')) v++;
+    if (v != eol) return -1;
+    *out = n;
+    return 0;
+}
+
+/**
+ * @Brief: Parses and handles one request at the start of data. Nothing is copied: headers and body
+ *         are read where they lie.
+ * @Param: loop Pointer to the worker loop.
+ * @Param: conn The connection the data came from.
+ * @Param: data Received bytes.
+ * @Param: len Number of received bytes.
+ * @Return: Bytes consumed, 0 if the request is not complete yet.
+ */
+static size_t ingest_request(struct ingest_loop *loop, struct ingest_conn *conn, const char *data, size_t len)
+{
+    const char *hdr_end = memmem(data, len, "\r\n\r\n", 4);
+    if (!hdr_end)
+    {
+        if (len < INGEST_SCRATCH) return 0;
+        conn->close_after = 1;
+        ingest_respond(loop, conn, 431, "Request Header Fields Too Large", "{\"status\": \"error\"}");
+        return len;
+    }
+    size_t hdr_len = (size_t)(hdr_end - data) + 4;
+
+    // Request line
+    const char *method = data;
+    const char *path = memchr(method, ' ', hdr_len);
+    if (!path)
+    {
+        conn->close_after = 1;
+        ingest_respond(loop, conn, 400, "Bad Request", "{\"status\": \"error\"}");
+        return len;
+    }
+    size_t method_len = (size_t)(path - method);
+    path++;
+    const char *version = memchr(path, ' ', (size_t)(hdr_end - path));
+    size_t path_len = version ? (size_t)(version - path) : 0;
+    int http10 = version && strncmp(version + 1, "HTTP/1.0", 8) == 0;
+
+    // Headers
+    size_t body_len = 0;
+    const char *content_type = NULL;
+    size_t content_type_len = 0;
+    int encoded = 0;
+    int unsupported = 0;
+    int transfer_encoded = 0;
+    int has_length = 0;
+    int bad_length = 0;
+    int keep_alive = !http10;
+    const char *line = memchr(data, '\n', hdr_len);
+    while (line && line + 1 < hdr_end)
+    {
+        line++;
+        const char *eol = memchr(line, '\r', (size_t)(hdr_end - line) + 1);
+        if (!eol) break;
+        if (strncasecmp(line, "Content-Length:", 15) == 0)
+        {
+            // A repeated header must agree with the first one, or the body's extent is ambiguous
+            size_t value;
+            if (ingest_parse_length(line + 15, eol, &value) != 0 || (has_length && value != body_len)) bad_length = 1;
+            body_len   = value;
+            has_length = 1;
+        }
+        else if (strncasecmp(line, "Content-Type:", 13) == 0)
+        {
+            content_type = line + 13;
+            while (*content_type == ' ') content_type++;
+            content_type_len = (size_t)(eol - content_type);
+        }
+        else if (strncasecmp(line, "Content-Encoding:", 17) == 0)
+        {
+            const char *v = line + 17;
+            while (*v == ' ') v++;
+            if (strncasecmp(v, "gzip", 4) == 0 || strncasecmp(v, "deflate", 7) == 0) encoded = 1;
+            else if (strncasecmp(v, "identity", 8) != 0) unsupported = 1;
+        }
+        else if (strncasecmp(line, "Transfer-Encoding:", 18) == 0)
+        {
+            transfer_encoded = 1;
+        }
+        else if (strncasecmp(line, "Connection:", 11) == 0)
+        {
+            const char *v = line + 11;
+            while (*v == ' ') v++;
+            if (strncasecmp(v, "close", 5) == 0) keep_alive = 0;
+            else if (strncasecmp(v, "keep-alive", 10) == 0) keep_alive = 1;
+        }
+        line = memchr(eol, '\n', (size_t)(hdr_end - eol) + 1);
+    }
+
+    // Only Content-Length framing is understood. A chunked body's extent is unknown, so the rest of
+    // the stream cannot be parsed as requests either
+    if (bad_length)
+    {
+        conn->close_after = 1;
+        ingest_respond(loop, conn, 400, "Bad Request", "{\"status\": \"error\"}");
+        return len;
+    }
+    if (transfer_encoded)
+    {
+        conn->close_after = 1;
+        ingest_respond(loop, conn, 501, "Not Implemented", "{\"status\": \"error\"}");
+        return len;
+    }
+    if (hdr_len > INGEST_SCRATCH || body_len > INGEST_SCRATCH - hdr_len)
+    {
+        conn->close_after = 1;
+        ingest_respond(loop, conn, 413, "Payload Too Large", "{\"status\": \"error\"}");
+        return len;
+    }
+    if (len < hdr_len + body_len) return 0;
+
+    loop->stats.requests++;
+    if (!keep_alive) conn->close_after = 1;
+    const char *body = data + hdr_len;
+
+    if (method_len != 4 || memcmp(method, "POST", 4) != 0)
+    {
+        ingest_respond(loop, conn, 405, "Method Not Allowed", "{\"status\": \"error\"}");
+        return hdr_len + body_len;
+    }
+    if (path_len != 5 || memcmp(path, "/post", 5) != 0)
+    {
+        ingest_respond(loop, conn, 404, "Not Found", "{\"status\": \"error\"}");
+        return hdr_len + body_len;
+    }
+
+    if (unsupported || (encoded && !loop->zstream_ready))
+    {
+        ingest_respond(loop, conn, 415, "Unsupported Media Type", "{\"status\": \"error\"}");
+        return hdr_len + body_len;
+    }
+    if (encoded)
+    {
+        // One inflate stream per worker; windowBits 15 + 32 accepts both the zlib and the gzip wrapper
+        z_stream *z = &loop->zstream;
+        inflateReset(z);
+        z->next_in   = (Bytef *)body;
+        z->avail_in  = (uInt)body_len;
+        z->next_out  = (Bytef *)loop->inflated;
+        z->avail_out = (uInt)sizeof(loop->inflated);
+        if (inflate(z, Z_FINISH) != Z_STREAM_END)
+        {
+            ingest_respond(loop, conn, 400, "Bad Request", "{\"status\": \"error\"}");
+            return hdr_len + body_len;
+        }
+        size_t consumed = hdr_len + body_len;
+        body     = loop->inflated;
+        body_len = sizeof(loop->inflated) - z->avail_out;
+        ingest_decode(loop, conn, content_type, content_type_len, body, body_len);
+        return consumed;
+    }
+    ingest_decode(loop, conn, content_type, content_type_len, body, body_len);
+    return hdr_len + body_len;
+}
+
+/**
+ * @Brief: Decodes a request body and stores its records, then queues the response.
+ * @Param: loop Pointer to the worker loop.
+ * @Param: conn The connection being answered.
+ * @Param: content_type Content-Type header value, NULL if absent.
+ * @Param: content_type_len Length of the Content-Type value.
+ * @Param: body The (decompressed) body.
+ * @Param: body_len Length of the body.
+ * @Return: void (the request is answered either way)
+ */
+static void ingest_decode(struct ingest_loop *loop, struct ingest_conn *conn, const char *content_type,
+                          size_t content_type_len, const char *body, size_t body_len)
+{
+    // Any format the client can send; without a known Content-Type the body is sniffed
+    codec_format_t format = content_type ? codec_format_from_content_type(content_type, content_type_len) : CODEC_FORMAT_UNKNOWN;
+    if (format == CODEC_FORMAT_UNKNOWN)
+    {
+        format = (body_len >= 2 && body[0] == 'S' && body[1] == 'N') ? CODEC_FORMAT_BINARY : CODEC_FORMAT_JSON;
+    }
+
+    char device_id[CODEC_DEVICE_ID_MAX];
+    int n = format == CODEC_FORMAT_BINARY
+        ? codec_bin_decode((const uint8_t *)body, body_len, device_id, sizeof(device_id), loop->records, CODEC_MAX_BATCH)
+        : codec_json_decode(body, body_len, device_id, sizeof(device_id), loop->records, CODEC_MAX_BATCH);
+    if (n <= 0)
+    {
+        ingest_respond(loop, conn, 400, "Bad Request", "{\"status\": \"error\"}");
+        return;
+    }
+    if (ingest_store(loop, device_id, loop->records, n) != 0)
+    {
+        ingest_respond(loop, conn, 503, "Service Unavailable", "{\"status\": \"error\"}");
+        return;
+    }
+
+    loop->stats.records += (uint64_t)n;
+    char reply[64];
+    snprintf(reply, sizeof(reply), "{\"status\": \"ok\", \"records\": %d}", n);
+    ingest_respond(loop, conn, 200, "OK", reply);
+}
+
+/**
+ * @Brief: Closes a connection and frees it.
+ * @Param: loop Pointer to the worker loop.
+ * @Param: conn The connection to close.
+ * @Return: void
+ */
+static void ingest_close(struct ingest_loop *loop, struct ingest_conn *conn)
+{
+    close(conn->fd);
+    if (conn->prev) conn->prev->next = conn->next;
+    else loop->conns = conn->next;
+    if (conn->next) conn->next->prev = conn->prev;
+    free(conn->in);
+    free(conn->out);
+    free(conn);
+    loop->stats.connections--;
+}
+
+/**
+ * @Brief: Sends pending response bytes. Whatever the socket does not take is kept on the connection and
+ *         reading pauses until it drains.
+ * @Param: loop Pointer to the worker loop.
+ * @Param: conn The connection to write to.
+ * @Return: 0 on success, -1 if the connection failed.
+ */
+static int ingest_send(struct ingest_loop *loop, struct ingest_conn *conn)
+{
+    if (loop->out_len > 0)
+    {
+        if (conn->out)
+        {
+            char *grown = realloc(conn->out, conn->out_len + loop->out_len);
+            if (!grown) return -1;
+            memcpy(grown + conn->out_len, loop->out, loop->out_len);
+            conn->out      = grown;
+            conn->out_len += loop->out_len;
+        }
+        else
+        {
+            ssize_t sent = send(conn->fd, loop->out, loop->out_len, MSG_NOSIGNAL);
+            if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK) return -1;
+            if (sent < 0) sent = 0;
+            if ((size_t)sent < loop->out_len)
+            {
+                conn->out_len  = loop->out_len - (size_t)sent;
+                conn->out_sent = 0;
+                conn->out      = malloc(conn->out_len);
+                if (!conn->out) return -1;
+                memcpy(conn->out, loop->out + sent, conn->out_len);
+                struct epoll_event ev = { .events = EPOLLOUT, .data.ptr = conn };
+                epoll_ctl(loop->worker->epfd, EPOLL_CTL_MOD, conn->fd, &ev);
+            }
+        }
+        loop->out_len = 0;
+        return 0;
+    }
+
+    // Socket became writable again
+    while (conn->out && conn->out_sent < conn->out_len)
+    {
+        ssize_t sent = send(conn->fd, conn->out + conn->out_sent, conn->out_len - conn->out_sent, MSG_NOSIGNAL);
+        if (sent < 0) return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+        conn->out_sent += (size_t)sent;
+    }
+    free(conn->out);
+    conn->out = NULL;
+    conn->out_len = conn->out_sent = 0;
+    struct epoll_event ev = { .events = EPOLLIN | EPOLLRDHUP, .data.ptr = conn };
+    epoll_ctl(loop->worker->epfd, EPOLL_CTL_MOD, conn->fd, &ev);
+    return 0;
+}
+
+/**
+ * @Brief: Reads everything available on a connection and handles every complete request in it.
+ * @Param: loop Pointer to the worker loop.
+ * @Param: conn The readable connection.
+ * @Return: 0 to keep the connection, -1 to close it.
+ */
+static int ingest_read(struct ingest_loop *loop, struct ingest_conn *conn)
+{
+    for (;;)
+    {
+        // Read into the worker's scratch unless a partial request is already parked on the connection
+        char *buf = loop->scratch;
+        size_t used = 0;
+        size_t cap = sizeof(loop->scratch);
+        if (conn->in)
+        {
+            if (conn->in_len == conn->in_cap && conn->in_cap < INGEST_SCRATCH)
+            {
+                size_t grown_cap = conn->in_cap * 2 < INGEST_SCRATCH ? conn->in_cap * 2 : INGEST_SCRATCH;
+                char *grown = realloc(conn->in, grown_cap);
+                if (!grown) return -1;
+                conn->in     = grown;
+                conn->in_cap = grown_cap;
+            }
+            buf  = conn->in;
+            used = conn->in_len;
+            cap  = conn->in_cap;
+        }
+
+        ssize_t n = recv(conn->fd, buf + used, cap - used, 0);
+        if (n == 0) return -1;
+        if (n < 0) return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+        loop->stats.bytes += (uint64_t)n;
+        used += (size_t)n;
+
+        size_t off = 0;
+        while (off < used && !conn->close_after)
+        {
+            size_t consumed = ingest_request(loop, conn, buf + off, used - off);
+            if (consumed == 0) break;
+            off += consumed;
+            // Keep room for the next response
+            if (sizeof(loop->out) - loop->out_len < 512 && ingest_send(loop, conn) != 0) return -1;
+        }
+
+        size_t left = used - off;
+        if (left == 0 || conn->close_after)
+        {
+            free(conn->in);
+            conn->in = NULL;
+            conn->in_len = conn->in_cap = 0;
+        }
+        else if (buf == loop->scratch)
+        {
+            conn->in_cap = left * 2 > 4096 ? (left * 2 < INGEST_SCRATCH ? left * 2 : INGEST_SCRATCH) : 4096;
+            conn->in = malloc(conn->in_cap);
+            if (!conn->in) return -1;
+            memcpy(conn->in, buf + off, left);
+            conn->in_len = left;
+        }
+        else
+        {
+            memmove(conn->in, conn->in + off, left);
+            conn->in_len = left;
+        }
+
+        if (ingest_send(loop, conn) != 0) return -1;
+        if (conn->close_after) return conn->out ? 0 : -1;
+        if (conn->out) return 0;   // Back-pressure: wait for EPOLLOUT
+    }
+}
+
+/**
+ * @Brief: Accepts every pending connection on the worker's listener.
+ * @Param: loop Pointer to the worker loop.
+ * @Return: void
+ */
+static void ingest_accept(struct ingest_loop *loop)
+{
+    for (;;)
+    {
+        int fd = accept4(loop->worker->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                LOG("[INGEST] accept failed: %s\n", strerror(errno));
+            }
+            return;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        struct ingest_conn *conn = calloc(1, sizeof(*conn));
+        if (!conn)
+        {
+            close(fd);
+            continue;
+        }
+        conn->fd = fd;
+        struct epoll_event ev = { .events = EPOLLIN | EPOLLRDHUP, .data.ptr = conn };
+        if (epoll_ctl(loop->worker->epfd, EPOLL_CTL_ADD, fd, &ev) < 0)
+        {
+            close(fd);
+            free(conn);
+            continue;
+        }
+        conn->next = loop->conns;
+        if (loop->conns) loop->conns->prev = conn;
+        loop->conns = conn;
+        loop->stats.connections++;
+        loop->stats.accepted++;
+    }
+}
+
+/**
+ * @Brief: Copies the worker's counters to where other threads read them.
+ * @Param: loop Pointer to the worker loop.
+ * @Return: void
+ */
+static void ingest_publish(struct ingest_loop *loop)
+{
+    const uint64_t *src = (const uint64_t *)&loop->stats;
+    uint64_t *dst = (uint64_t *)&loop->worker->stats;
+    for (size_t i = 0; i < sizeof(loop->stats) / sizeof(uint64_t); i++)
+    {
+        __atomic_store_n(&dst[i], src[i], __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @Brief: Worker thread: accepts, reads, parses and stores until the server is stopped.
+ * @Param: arg Pointer to the ingest_worker_t structure.
+ * @Return: NULL
+ */
+static void *ingest_worker_main(void *arg)
+{
+    struct ingest_worker *worker = (struct ingest_worker *)arg;
+    struct ingest_loop *loop = calloc(1, sizeof(*loop));
+    if (!loop)
+    {
+        LOG("[INGEST] Worker %d failed to start\n", worker->id);
+        return NULL;
+    }
+    loop->worker = worker;
+    loop->zstream_ready = inflateInit2(&loop->zstream, 15 + 32) == Z_OK;
+
+    struct epoll_event events[INGEST_MAX_EVENTS];
+    long long last_flush = ingest_now_ms();
+
+    while (__atomic_load_n(&worker->ingest->running, __ATOMIC_RELAXED))
+    {
+        int n = epoll_wait(worker->epfd, events, INGEST_MAX_EVENTS, INGEST_FLUSH_MS / 4);
+        for (int i = 0; i < n; i++)
+        {
+            struct ingest_conn *conn = events[i].data.ptr;
+            if (!conn)
+            {
+                ingest_accept(loop);
+                continue;
+            }
+            int rv = 0;
+            if (events[i].events & EPOLLOUT)
+            {
+                rv = ingest_send(loop, conn);
+                if (rv == 0 && !conn->out && conn->close_after) rv = -1;
+            }
+            if (rv == 0 && events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+            {
+                rv = ingest_read(loop, conn);
+            }
+            if (rv != 0) ingest_close(loop, conn);
+        }
+
+        long long now = ingest_now_ms();
+        if (now - last_flush >= INGEST_FLUSH_MS)
+        {
+            ingest_flush_dirty(loop);
+            last_flush = now;
+        }
+        ingest_publish(loop);
+    }
+
+    ingest_flush_dirty(loop);
+    ingest_publish(loop);
+    while (loop->conns) ingest_close(loop, loop->conns);
+    for (size_t i = 0; i < loop->devices_cap; i++) free(loop->devices[i]);
+    free(loop->devices);
+    if (loop->zstream_ready) inflateEnd(&loop->zstream);
+    free(loop);
+    return NULL;
+}
+
+/**
+ * @Brief: Creates one listener per worker on the same address (SO_REUSEPORT) and the output directory.
+ * @Param: self Pointer to the ingest_t pointer to store the allocated structure.
+ * @Param: bind_host Address to listen on.
+ * @Param: port Port to listen on, "0" for an ephemeral one (see self->port).
+ * @Param: dir Directory receiving the column files (created if missing).
+ * @Param: n_workers Number of worker threads.
+ * @Return: 0 on success, -1 on failure (invalid arguments, socket or memory error).
+ */
+int ingest_init(struct ingest **self, const char *bind_host, const char *port, const char *dir, int n_workers)
+{
+    if (n_workers <= 0 || n_workers > INGEST_MAX_WORKERS) return -1;
+    if (mkdir(dir, 0755) < 0 && errno != EEXIST)
+    {
+        LOG("[INGEST] Failed to create %s: %s\n", dir, strerror(errno));
+        return -1;
+    }
+
+    *self = (struct ingest *)calloc(1, sizeof(struct ingest));
+    if (!*self) return -1;
+    (*self)->dir       = strdup(dir);
+    (*self)->n_workers = n_workers;
+    for (int i = 0; i < INGEST_MAX_WORKERS; i++)
+    {
+        (*self)->workers[i].listen_fd = -1;
+        (*self)->workers[i].epfd      = -1;
+    }
+
+    char bound_port[16];
+    snprintf(bound_port, sizeof(bound_port), "%s", port);
+
+    for (int i = 0; i < n_workers; i++)
+    {
+        struct ingest_worker *worker = &(*self)->workers[i];
+        worker->ingest = *self;
+        worker->id     = i;
+
+        struct addrinfo hints, *res;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family   = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags    = AI_PASSIVE;
+        int ret = getaddrinfo(bind_host, bound_port, &hints, &res);
+        if (ret != 0)
+        {
+            LOG("[INGEST] getaddrinfo failed: %s\n", gai_strerror(ret));
+            ingest_dispose(self);
+            return -1;
+        }
+
+        int fd = socket(res->ai_family, res->ai_socktype | SOCK_CLOEXEC, res->ai_protocol);
+        int one = 1;
+        if (fd < 0 ||
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0 ||
+            setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0 ||
+            bind(fd, res->ai_addr, res->ai_addrlen) < 0 ||
+            listen(fd, SOMAXCONN) < 0 ||
+            ingest_set_nonblocking(fd) < 0)
+        {
+            LOG("[INGEST] Failed to listen on %s:%s: %s\n", bind_host, bound_port, strerror(errno));
+            if (fd >= 0) close(fd);
+            freeaddrinfo(res);
+            ingest_dispose(self);
+            return -1;
+        }
+        freeaddrinfo(res);
+        worker->listen_fd = fd;
+
+        // Every further listener joins the port the first one got
+        struct sockaddr_storage addr;
+        socklen_t addr_len = sizeof(addr);
+        if (i == 0 && getsockname(fd, (struct sockaddr *)&addr, &addr_len) == 0)
+        {
+            (*self)->port = ntohs(addr.ss_family == AF_INET6 ? ((struct sockaddr_in6 *)&addr)->sin6_port
+                                                             : ((struct sockaddr_in *)&addr)->sin_port);
+            snprintf(bound_port, sizeof(bound_port), "%u", (*self)->port);
+        }
+
+        worker->epfd = epoll_create1(EPOLL_CLOEXEC);
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+        if (worker->epfd < 0 || epoll_ctl(worker->epfd, EPOLL_CTL_ADD, fd, &ev) < 0)
+        {
+            ingest_dispose(self);
+            return -1;
+        }
+    }
+
+    LOG("[INGEST] Listening on %s:%u with %d worker(s), writing to %s\n", bind_host, (*self)->port, n_workers, dir);
+    return 0;
+}
+
+/**
+ * @Brief: Starts the worker threads, each pinned to its own core.
+ * @Param: self Pointer to the initialized ingest_t structure.
+ * @Return: 0 on success, -1 if a thread could not be created.
+ */
+int ingest_start(struct ingest *self)
+{
+    long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n_cpus <= 0) n_cpus = 1;
+
+    __atomic_store_n(&self->running, 1, __ATOMIC_RELAXED);
+    for (int i = 0; i < self->n_workers; i++)
+    {
+        pthread_attr_t attr;
+        cpu_set_t cpus;
+        pthread_attr_init(&attr);
+        CPU_ZERO(&cpus);
+        CPU_SET((int)(i % n_cpus), &cpus);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+
+        int rv = pthread_create(&self->workers[i].thread, &attr, ingest_worker_main, &self->workers[i]);
+        pthread_attr_destroy(&attr);
+        if (rv != 0)
+        {
+            LOG("[INGEST] Failed to start worker %d\n", i);
+            self->n_workers = i;
+            ingest_stop(self);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @Brief: Sums the counters of every worker.
+ * @Param: self Pointer to the initialized ingest_t structure.
+ * @Param: out Destination totals.
+ * @Return: void
+ */
+void ingest_stats(struct ingest *self, struct ingest_stats *out)
+{
+    memset(out, 0, sizeof(*out));
+    uint64_t *dst = (uint64_t *)out;
+    for (int w = 0; w < self->n_workers; w++)
+    {
+        const uint64_t *src = (const uint64_t *)&self->workers[w].stats;
+        for (size_t i = 0; i < sizeof(*out) / sizeof(uint64_t); i++)
+        {
+            dst[i] += __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/**
+ * @Brief: Stops the workers and waits for them; buffered rows are written out first.
+ * @Param: self Pointer to the initialized ingest_t structure.
+ * @Return: void
+ */
+void ingest_stop(struct ingest *self)
+{
+    if (!__atomic_exchange_n(&self->running, 0, __ATOMIC_RELAXED)) return;
+    for (int i = 0; i < self->n_workers; i++)
+    {
+        pthread_join(self->workers[i].thread, NULL);
+    }
+}
+
+/**
+ * @Brief: Stops the server if needed, closes the listeners and frees the structure.
+ * @Param: self Pointer to the ingest_t pointer to be disposed and set to NULL.
+ * @Return: 0 on success, -1 if the pointer is invalid.
+ */
+int ingest_dispose(struct ingest **self)
+{
+    if (!self || !*self) return -1;
+    ingest_stop(*self);
+    for (int i = 0; i < INGEST_MAX_WORKERS; i++)
+    {
+        if ((*self)->workers[i].listen_fd >= 0) close((*self)->workers[i].listen_fd);
+        if ((*self)->workers[i].epfd >= 0) close((*self)->workers[i].epfd);
+    }
+    free((*self)->dir);
+    free(*self);
+    *self = NULL;
+    return 0;
+}
@@ -0,0 +1,13 @@
+#include "log.h"
+
+int log_verbose = 1;
+
+/**
+ * @Brief: Enables or disables diagnostic output from the library modules.
+ * @Param: verbose Non-zero to log to stdout (default), zero to stay silent.
+ * @Return: void
+ */
+void log_set_verbose(int verbose)
+{
+    log_verbose = verbose ? 1 : 0;
+}
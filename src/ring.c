@@ -0,0 +1,81 @@
+#include "ring.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @Brief: Allocates a ring; the capacity is rounded up to a power of two.
+ * @Param: self Pointer to the ring_t pointer to store the allocated structure.
+ * @Param: capacity Minimum number of messages the ring can hold.
+ * @Param: msg_size Size of one message in bytes.
+ * @Return: 0 on success, -1 on failure (invalid size or memory allocation error).
+ */
+int ring_init(struct ring **self, size_t capacity, size_t msg_size)
+{
+    if (capacity == 0 || msg_size == 0) return -1;
+
+    size_t cap = 1;
+    while (cap < capacity) cap <<= 1;
+
+    *self = (struct ring *)aligned_alloc(RING_CACHE_LINE, sizeof(struct ring));
+    if (!*self) return -1;
+    memset(*self, 0, sizeof(struct ring));
+
+    (*self)->slots = calloc(cap, msg_size);
+    if (!(*self)->slots)
+    {
+        free(*self);
+        *self = NULL;
+        return -1;
+    }
+    (*self)->mask     = cap - 1;
+    (*self)->msg_size = msg_size;
+    return 0;
+}
+
+/**
+ * @Brief: Copies a message into the ring. Must only be called from the producer thread.
+ * @Param: self Pointer to the initialized ring_t structure.
+ * @Param: msg The message to copy (msg_size bytes).
+ * @Return: 0 on success, -1 if the ring is full.
+ */
+int ring_push(struct ring *self, const void *msg)
+{
+    size_t tail = __atomic_load_n(&self->tail, __ATOMIC_RELAXED);
+    size_t head = __atomic_load_n(&self->head, __ATOMIC_ACQUIRE);
+    if (tail - head > self->mask) return -1;
+
+    memcpy(self->slots + (tail & self->mask) * self->msg_size, msg, self->msg_size);
+    __atomic_store_n(&self->tail, tail + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/**
+ * @Brief: Copies the oldest message out of the ring. Must only be called from the consumer thread.
+ * @Param: self Pointer to the initialized ring_t structure.
+ * @Param: msg Destination buffer (msg_size bytes).
+ * @Return: 0 on success, -1 if the ring is empty.
+ */
+int ring_pop(struct ring *self, void *msg)
+{
+    size_t head = __atomic_load_n(&self->head, __ATOMIC_RELAXED);
+    size_t tail = __atomic_load_n(&self->tail, __ATOMIC_ACQUIRE);
+    if (head == tail) return -1;
+
+    memcpy(msg, self->slots + (head & self->mask) * self->msg_size, self->msg_size);
+    __atomic_store_n(&self->head, head + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/**
+ * @Brief: Frees the ring and its slots.
+ * @Param: self Pointer to the ring_t pointer to be disposed and set to NULL.
+ * @Return: 0 on success, -1 if the pointer is invalid.
+ */
+int ring_dispose(struct ring **self)
+{
+    if (!self || !*self) return -1;
+    free((*self)->slots);
+    free(*self);
+    *self = NULL;
+    return 0;
+}
@@ -0,0 +1,202 @@
+#include "shm.h"
+#include "log.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+
+#define SHM_RECORD_WORDS (sizeof(struct shm_record) / sizeof(uint64_t))
+#define SHM_READ_TRIES   1000000
+
+_Static_assert(sizeof(struct shm_record) % sizeof(uint64_t) == 0, "shm_record must be a whole number of words");
+
+/**
+ * @Brief: Builds the shared-memory object name for a device ("/ssn1-<device_id>", '/' replaced by '_').
+ * @Param: buf Destination string buffer.
+ * @Param: cap Size of the destination buffer.
+ * @Param: device_id A unique identifier for the sensor.
+ * @Return: void
+ */
+void shm_segment_name(char *buf, size_t cap, const char *device_id)
+{
+    snprintf(buf, cap, "/ssn1-%s", device_id);
+    for (char *p = buf + 1; *p; p++)
+    {
+        if (*p == '/') *p = '_';
+    }
+}
+
+/**
+ * @Brief: Creates (or reuses) the shared-memory segment for a device and maps it for writing.
+ * @Param: self Pointer to the shm_writer_t pointer to store the allocated structure.
+ * @Param: device_id A unique identifier for the sensor.
+ * @Return: 0 on success, -1 on failure (memory, shm_open or mmap error).
+ */
+int shm_writer_open(struct shm_writer **self, const char *device_id)
+{
+    *self = (struct shm_writer *)calloc(1, sizeof(struct shm_writer));
+    if (!*self) return -1;
+    shm_segment_name((*self)->name, sizeof((*self)->name), device_id);
+
+    int fd = shm_open((*self)->name, O_CREAT | O_RDWR, 0644);
+    if (fd < 0 || ftruncate(fd, sizeof(struct shm_segment)) < 0)
+    {
+        LOG("[SHM] Failed to create %s: %s\n", (*self)->name, strerror(errno));
+        if (fd >= 0) close(fd);
+        free(*self);
+        *self = NULL;
+        return -1;
+    }
+
+    void *map = mmap(NULL, sizeof(struct shm_segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        LOG("[SHM] Failed to map %s\n", (*self)->name);
+        free(*self);
+        *self = NULL;
+        return -1;
+    }
+
+    (*self)->segment = (struct shm_segment *)map;
+    // Restart on an even sequence in case a previous writer died mid-update
+    __atomic_store_n(&(*self)->segment->seq, (__atomic_load_n(&(*self)->segment->seq, __ATOMIC_RELAXED) + 1) & ~1u, __ATOMIC_RELEASE);
+    (*self)->segment->version = SHM_VERSION;
+    __atomic_store_n(&(*self)->segment->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+
+    LOG("[SHM] Publishing to %s\n", (*self)->name);
+    return 0;
+}
+
+/**
+ * @Brief: Publishes a record under the seqlock. Never blocks and makes no syscalls.
+ * @Param: self Pointer to the initialized shm_writer_t structure.
+ * @Param: record The values to publish (its updates field is filled in by the writer).
+ * @Return: void
+ */
+void shm_publish(struct shm_writer *self, const struct shm_record *record)
+{
+    if (!self || !self->segment) return;
+    struct shm_segment *seg = self->segment;
+
+    struct shm_record next = *record;
+    next.updates = seg->record.updates + 1;
+
+    uint32_t seq = __atomic_load_n(&seg->seq, __ATOMIC_RELAXED);
+    __atomic_store_n(&seg->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    // Word-sized relaxed stores keep the concurrent reader copy free of torn words
+    const uint64_t *src = (const uint64_t *)&next;
+    uint64_t *dst = (uint64_t *)&seg->record;
+    for (size_t i = 0; i < SHM_RECORD_WORDS; i++)
+    {
+        __atomic_store_n(&dst[i], src[i], __ATOMIC_RELAXED);
+    }
+
+    __atomic_store_n(&seg->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/**
+ * @Brief: Unmaps and unlinks the segment, then frees the writer.
+ * @Param: self Pointer to the shm_writer_t pointer to be disposed and set to NULL.
+ * @Return: 0 on success, -1 if the pointer is invalid.
+ */
+int shm_writer_close(struct shm_writer **self)
+{
+    if (!self || !*self) return -1;
+    if ((*self)->segment)
+    {
+        munmap((*self)->segment, sizeof(struct shm_segment));
+        shm_unlink((*self)->name);
+    }
+    free(*self);
+    *self = NULL;
+    return 0;
+}
+
+/**
+ * @Brief: Maps a device's segment read-only for a local consumer.
+ * @Param: self Pointer to the shm_reader_t pointer to store the allocated structure.
+ * @Param: device_id A unique identifier for the sensor.
+ * @Return: 0 on success, -1 on failure (no such segment, not an SSN-1 segment, or memory error).
+ */
+int shm_reader_open(struct shm_reader **self, const char *device_id)
+{
+    char name[SHM_NAME_MAX];
+    shm_segment_name(name, sizeof(name), device_id);
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) return -1;
+
+    void *map = mmap(NULL, sizeof(struct shm_segment), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+
+    struct shm_segment *seg = (struct shm_segment *)map;
+    if (__atomic_load_n(&seg->magic, __ATOMIC_ACQUIRE) != SHM_MAGIC || seg->version != SHM_VERSION)
+    {
+        munmap(map, sizeof(struct shm_segment));
+        return -1;
+    }
+
+    *self = (struct shm_reader *)calloc(1, sizeof(struct shm_reader));
+    if (!*self)
+    {
+        munmap(map, sizeof(struct shm_segment));
+        return -1;
+    }
+    (*self)->segment = seg;
+    return 0;
+}
+
+/**
+ * @Brief: Takes a consistent snapshot of the published record, retrying while an update is in progress.
+ * @Param: self Pointer to the initialized shm_reader_t structure.
+ * @Param: out Destination record.
+ * @Return: 0 on success, -1 if no consistent copy could be taken (writer stuck mid-update).
+ */
+int shm_read(struct shm_reader *self, struct shm_record *out)
+{
+    if (!self || !self->segment) return -1;
+    struct shm_segment *seg = self->segment;
+    const uint64_t *src = (const uint64_t *)&seg->record;
+    uint64_t *dst = (uint64_t *)out;
+
+    for (int tries = 0; tries < SHM_READ_TRIES; tries++)
+    {
+        uint32_t before = __atomic_load_n(&seg->seq, __ATOMIC_ACQUIRE);
+        if (before & 1)
+        {
+            self->retries++;
+            continue;
+        }
+
+        for (size_t i = 0; i < SHM_RECORD_WORDS; i++)
+        {
+            dst[i] = __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+        }
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&seg->seq, __ATOMIC_RELAXED) == before) return 0;
+        self->retries++;
+    }
+    return -1;
+}
+
+/**
+ * @Brief: Unmaps the segment and frees the reader.
+ * @Param: self Pointer to the shm_reader_t pointer to be disposed and set to NULL.
+ * @Return: 0 on success, -1 if the pointer is invalid.
+ */
+int shm_reader_close(struct shm_reader **self)
+{
+    if (!self || !*self) return -1;
+    if ((*self)->segment) munmap((*self)->segment, sizeof(struct shm_segment));
+    free(*self);
+    *self = NULL;
+    return 0;
+}
@@ -0,0 +1,308 @@
+#include "source.h"
+#include "log.h"
+#include "container.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* SIMULATED SOURCE */
+struct source_sim
+{
+    struct ssn1_source base;
+    double low;
+    double high;
+    unsigned int seed;  // Private generator state, so sources on different threads never contend
+};
+
+/**
+ * @Brief: Generates random samples in a range slightly over the configured thresholds.
+ * @Param: base Pointer to the embedded ssn1_source structure.
+ * @Param: out Destination array.
+ * @Param: max Number of samples to generate.
+ * @Return: Number of samples written (always max).
+ */
+static int source_sim_read(struct ssn1_source *base, double *out, size_t max)
+{
+    struct source_sim *self = CONTAINER_OF(base, struct source_sim, base);
+    for (size_t i = 0; i < max; i++)
+    {
+        double norm_rand = (double)rand_r(&self->seed) / (double)RAND_MAX;
+        out[i] = self->low + (norm_rand * (self->high - self->low + 1));
+    }
+    return (int)max;
+}
+
+/**
+ * @Brief: Frees a simulated source.
+ * @Param: base Pointer to the embedded ssn1_source structure.
+ * @Return: void
+ */
+static void source_sim_close(struct ssn1_source *base)
+{
+    free(CONTAINER_OF(base, struct source_sim, base));
+}
+
+static const struct ssn1_source_ops source_sim_ops = { "sim", source_sim_read, source_sim_close };
+
+/**
+ * @Brief: Opens a simulated source producing uniform random values in [low, high + 1) from a given seed.
+ * @Param: self Pointer to the source pointer to store the allocated structure.
+ * @Param: low Lower bound of the generated range.
+ * @Param: high Upper bound of the generated range (exceeded by up to 1 degree).
+ * @Param: seed Initial state of the source's private generator.
+ * @Return: 0 on success, -1 on memory allocation failure.
+ */
+int source_sim_open_seeded(struct ssn1_source **self, double low, double high, unsigned int seed)
+{
+    struct source_sim *sim = calloc(1, sizeof(*sim));
+    if (!sim) return -1;
+    sim->base.ops = &source_sim_ops;
+    sim->low      = low;
+    sim->high     = high;
+    sim->seed     = seed;
+    *self = &sim->base;
+    return 0;
+}
+
+/**
+ * @Brief: Opens a simulated source producing uniform random values in [low, high + 1), seeded from rand().
+ * @Param: self Pointer to the source pointer to store the allocated structure.
+ * @Param: low Lower bound of the generated range.
+ * @Param: high Upper bound of the generated range (exceeded by up to 1 degree).
+ * @Return: 0 on success, -1 on memory allocation failure.
+ */
+int source_sim_open(struct ssn1_source **self, double low, double high)
+{
+    return source_sim_open_seeded(self, low, high, (unsigned int)rand());
+}
+
+/* CSV REPLAY SOURCE */
+struct source_csv
+{
+    struct ssn1_source base;
+    FILE *file;
+};
+
+/**
+ * @Brief: Reads samples from a CSV file, one per line. The last field of each line is the value,
+ *         so both "value" and "timestamp,value" rows work; lines that do not parse (headers) are skipped.
+ * @Param: base Pointer to the embedded ssn1_source structure.
+ * @Param: out Destination array.
+ * @Param: max Maximum number of samples to read.
+ * @Return: Number of samples read, 0 at end of file.
+ */
+static int source_csv_read(struct ssn1_source *base, double *out, size_t max)
+{
+    struct source_csv *self = CONTAINER_OF(base, struct source_csv, base);
+    char line[256];
+    size_t n = 0;
+
+    while (n < max && fgets(line, sizeof(line), self->file))
+    {
+        char *field = strrchr(line, ',');
+        field = field ? field + 1 : line;
+
+        char *end;
+        double value = strtod(field, &end);
+        if (end == field) continue;
+        out[n++] = value;
+    }
+    return (int)n;
+}
+
+/**
+ * @Brief: Closes the CSV file and frees the source.
+ * @Param: base Pointer to the embedded ssn1_source structure.
+ * @Return: void
+ */
+static void source_csv_close(struct ssn1_source *base)
+{
+    struct source_csv *self = CONTAINER_OF(base, struct source_csv, base);
+    if (self->file) fclose(self->file);
+    free(self);
+}
+
+static const struct ssn1_source_ops source_csv_ops = { "csv", source_csv_read, source_csv_close };
+
+/**
+ * @Brief: Opens a CSV file for replay.
+ * @Param: self Pointer to the source pointer to store the allocated structure.
+ * @Param: path Path to the CSV file.
+ * @Return: 0 on success, -1 on failure (memory or file error).
+ */
+int source_csv_open(struct ssn1_source **self, const char *path)
+{
+    struct source_csv *csv = calloc(1, sizeof(*csv));
+    if (!csv) return -1;
+
+    csv->file = fopen(path, "r");
+    if (!csv->file)
+    {
+        LOG("[SOURCE] Failed to open %s\n", path);
+        free(csv);
+        return -1;
+    }
+    // Large stdio buffer so replay is not bound by read() calls
+    setvbuf(csv->file, NULL, _IOFBF, 1 << 16);
+
+    csv->base.ops = &source_csv_ops;
+    *self = &csv->base;
+    return 0;
+}
+
+/* MEMORY-MAPPED BINARY TRACE SOURCE */
+struct source_trace
+{
+    struct ssn1_source base;
+    const uint8_t *map;
+    size_t map_len;
+    size_t pos;     // Byte offset of the next sample
+};
+
+/**
+ * @Brief: Copies a block of samples straight out of the mapped trace.
+ * @Param: base Pointer to the embedded ssn1_source structure.
+ * @Param: out Destination array.
+ * @Param: max Maximum number of samples to read.
+ * @Return: Number of samples read, 0 at end of trace.
+ */
+static int source_trace_read(struct ssn1_source *base, double *out, size_t max)
+{
+    struct source_trace *self = CONTAINER_OF(base, struct source_trace, base);
+    size_t avail = (self->map_len - self->pos) / sizeof(double);
+    size_t n = avail < max ? avail : max;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    memcpy(out, self->map + self->pos, n * sizeof(double));
+#else
+    for (size_t i = 0; i < n; i++)
+    {
+        uint64_t bits = 0;
+        for (int b = 7; b >= 0; b--) bits = (bits << 8) | self->map[self->pos + i * 8 + b];
+        memcpy(&out[i], &bits, sizeof(bits));
+    }
+#endif
+    self->pos += n * sizeof(double);
+    return (int)n;
+}
+
+/**
+ * @Brief: Unmaps the trace and frees the source.
+ * @Param: base Pointer to the embedded ssn1_source structure.
+ * @Return: void
+ */
+static void source_trace_close(struct ssn1_source *base)
+{
+    struct source_trace *self = CONTAINER_OF(base, struct source_trace, base);
+    if (self->map) munmap((void *)self->map, self->map_len);
+    free(self);
+}
+
+static const struct ssn1_source_ops source_trace_ops = { "trace", source_trace_read, source_trace_close };
+
+/**
+ * @Brief: Maps a binary trace file (see SOURCE_TRACE_MAGIC) for replay.
+ * @Param: self Pointer to the source pointer to store the allocated structure.
+ * @Param: path Path to the trace file.
+ * @Return: 0 on success, -1 on failure (memory, file or format error).
+ */
+int source_trace_open(struct ssn1_source **self, const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        LOG("[SOURCE] Failed to open %s\n", path);
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < SOURCE_TRACE_MAGIC_LEN)
+    {
+        LOG("[SOURCE] %s is not a trace file\n", path);
+        close(fd);
+        return -1;
+    }
+
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        LOG("[SOURCE] Failed to map %s\n", path);
+        return -1;
+    }
+    if (memcmp(map, SOURCE_TRACE_MAGIC, SOURCE_TRACE_MAGIC_LEN) != 0)
+    {
+        LOG("[SOURCE] %s has no trace header\n", path);
+        munmap(map, (size_t)st.st_size);
+        return -1;
+    }
+    madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    struct source_trace *trace = calloc(1, sizeof(*trace));
+    if (!trace)
+    {
+        munmap(map, (size_t)st.st_size);
+        return -1;
+    }
+    trace->base.ops = &source_trace_ops;
+    trace->map      = map;
+    trace->map_len  = (size_t)st.st_size;
+    trace->pos      = SOURCE_TRACE_MAGIC_LEN;
+    *self = &trace->base;
+    return 0;
+}
+
+/**
+ * @Brief: Opens a replay source, picking the binary trace backend when the file has a trace header and CSV otherwise.
+ * @Param: self Pointer to the source pointer to store the allocated structure.
+ * @Param: path Path to the recording.
+ * @Return: 0 on success, -1 on failure.
+ */
+int source_open(struct ssn1_source **self, const char *path)
+{
+    char magic[SOURCE_TRACE_MAGIC_LEN] = { 0 };
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        LOG("[SOURCE] Failed to open %s\n", path);
+        return -1;
+    }
+    size_t n = fread(magic, 1, sizeof(magic), file);
+    fclose(file);
+
+    if (n == sizeof(magic) && memcmp(magic, SOURCE_TRACE_MAGIC, sizeof(magic)) == 0)
+    {
+        return source_trace_open(self, path);
+    }
+    return source_csv_open(self, path);
+}
+
+/**
+ * @Brief: Reads a block of samples from any source.
+ * @Param: self Pointer to the source.
+ * @Param: out Destination array.
+ * @Param: max Maximum number of samples to read.
+ * @Return: Number of samples read, 0 at end of stream, -1 on error.
+ */
+int source_read(struct ssn1_source *self, double *out, size_t max)
+{
+    if (!self || !self->ops || !self->ops->read) return -1;
+    return self->ops->read(self, out, max);
+}
+
+/**
+ * @Brief: Closes a source and sets the pointer to NULL.
+ * @Param: self Pointer to the source pointer.
+ * @Return: void
+ */
+void source_close(struct ssn1_source **self)
+{
+    if (!self || !*self) return;
+    if ((*self)->ops && (*self)->ops->close) (*self)->ops->close(*self);
+    *self = NULL;
+}
@@ -1,17 +1,98 @@
 #include "ssn-1.h"
+#include "log.h"
 #include "http.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <time.h>
 #include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 /* PRIVATE FUNCTIONS */
 /**
- * @Brief: Simulates reading temperature from a physical sensor.
+ * @Brief: Takes the next temperature reading from the attached source or the built-in simulation.
  * @Param: self Pointer to the ssn1_t structure.
- * @Return: A double representing the simulated temperature reading.
+ * @Param: out Destination for the reading.
+ * @Return: 0 on success, -1 when the source is exhausted.
  */ 
-double ssn1_sensor(struct ssn1 *self);
+static int ssn1_sensor(struct ssn1 *self, double *out);
+
+/**
+ * @Brief: Puts the records of a failed upload back in front of the spool so they are retried first.
+ * @Param: self Pointer to the ssn1_t structure.
+ * @Return: void
+ */
+static void ssn1_requeue_inflight(struct ssn1 *self);
+
+/**
+ * @Brief: Takes delivered averages as the reference for the report policy.
+ * @Param: self Pointer to the ssn1_t structure.
+ * @Param: records The delivered records, in chronological order.
+ * @Param: count Number of records.
+ * @Return: void
+ */
+static void ssn1_mark_sent(struct ssn1 *self, const struct temp_record *records, int count);
+
+/**
+ * @Brief: Returns the current time from the attached clock, or the wall clock if none is set.
+ * @Param: self Pointer to the ssn1_t structure.
+ * @Return: The current time.
+ */
+static time_t ssn1_now(struct ssn1 *self)
+{
+    if (self->clock && self->clock->now_fn) return self->clock->now_fn(self->clock);
+    return time(NULL);
+}
+
+/**
+ * @Brief: Stamps the current time for the links: the attached clock in whole seconds, or
+ *         CLOCK_MONOTONIC if none is set.
+ * @Param: self Pointer to the ssn1_t structure.
+ * @Param: out Destination timestamp.
+ * @Return: void
+ */
+static void ssn1_stamp(struct ssn1 *self, struct timespec *out)
+{
+    if (!self->clock) 
+    {
+        clock_gettime(CLOCK_MONOTONIC, out);
+        return;
+    }
+    out->tv_sec  = ssn1_now(self);
+    out->tv_nsec = 0;
+}
+
+/**
+ * @Brief: Clock callback of the HTTP clients while the node runs on an attached clock.
+ * @Param: cb_handle Pointer to the embedded tcp_clock structure.
+ * @Param: now Destination timestamp.
+ * @Return: void
+ */
+static void ssn1_link_clock(struct tcp_clock *cb_handle, struct timespec *now)
+{
+    struct ssn1 *self = CONTAINER_OF(cb_handle, struct ssn1, link_clock_handle);
+    ssn1_stamp(self, now);
+}
+
+/**
+ * @Brief: Holds routine uploads for a server-requested time, plus up to 10% jitter so a fleet
+ *         told to back off together does not come back together.
+ * @Param: self Pointer to the ssn1_t structure.
+ * @Param: now The current time.
+ * @Param: seconds Requested hold.
+ * @Return: void
+ */
+static void ssn1_hold_uploads(struct ssn1 *self, time_t now, long seconds)
+{
+    if (seconds <= 0) return;
+    if (seconds > SSN1_UPLOAD_INTERVAL_MAX) seconds = SSN1_UPLOAD_INTERVAL_MAX;
+    time_t until = now + seconds + rand_r(&self->seed) % (seconds / 10 + 1);
+    if (until > self->upload_hold_until) self->upload_hold_until = until;
+}
 
 /**
  * @Brief: Callback function executed by the HTTP client upon successful receipt of a server response.
@@ -22,39 +103,170 @@ double ssn1_sensor(struct ssn1 *self);
 static int ssn1_http_callback(struct http_cb *cb_handle, const char *response)
 {
     struct ssn1 *self = CONTAINER_OF(cb_handle, struct ssn1, http_handle);
+    struct http_response parsed;
+    struct codec_control control;
+    time_t now = ssn1_now(self);
     
-    printf("\n");
-    printf("========================================\n");
-    printf("  SERVER RESPONSE\n");
-    printf("========================================\n");
-    printf("%s\n", response);
-    printf("========================================\n");
-    printf("\n");
+    LOG("\n");
+    LOG("========================================\n");
+    LOG("  SERVER RESPONSE\n");
+    LOG("========================================\n");
+    LOG("%s\n", response);
+    LOG("========================================\n");
+    LOG("\n");
     
     self->sending = 0;  // Done sending
+    http_parse_response(response, now, &parsed);
+    codec_control_decode(parsed.body, &control);
+
+    if (parsed.status == 429 || parsed.status == 503) 
+    {
+        // The server is shedding load: keep the batch and stay quiet for as long as it asks
+        long wait = parsed.retry_after >= 0 ? parsed.retry_after 
+                  : control.retry_after >= 0 ? control.retry_after : SSN1_RETRY_AFTER_DEFAULT;
+        ssn1_requeue_inflight(self);
+        ssn1_hold_uploads(self, now, wait);
+        self->server_throttles++;
+        LOG("[SSN1] Server busy (%d), holding uploads for %lds\n", parsed.status, wait);
+    }
+    else if (parsed.status >= 200 && parsed.status < 300) 
+    {
+        // Only what the server accepted leaves the node and becomes the reference for the report policy
+        ssn1_mark_sent(self, self->inflight, self->inflight_count);
+        self->inflight_count = 0;
+        if (control.retry_after > 0) ssn1_hold_uploads(self, now, control.retry_after);
+    }
+    else if (http_status_transient(parsed.status)) 
+    {
+        // A transient failure: the batch goes back ahead of the spool and the link's retry
+        // policy spaces out the next try
+        LOG("[SSN1] Upload not accepted by server (%d), requeueing %d average(s)\n", 
+               parsed.status, self->inflight_count);
+        ssn1_requeue_inflight(self);
+        if (control.retry_after > 0) ssn1_hold_uploads(self, now, control.retry_after);
+    }
+    else 
+    {
+        // Any other answer will be refused again however often it is sent; drop the batch so it
+        // does not block the spool behind it
+        LOG("[SSN1] Upload rejected by server (%d), dropping %d average(s)\n", 
+               parsed.status, self->inflight_count);
+        self->upload_rejected += (unsigned long)self->inflight_count;
+        self->inflight_count = 0;
+        if (control.retry_after > 0) ssn1_hold_uploads(self, now, control.retry_after);
+    }
+
+    if (control.interval >= 0 || control.batch >= 0) 
+    {
+        ssn1_set_upload_pacing(self, control.interval >= 0 ? (time_t)control.interval : self->upload_interval_set,
+                                     control.batch >= 0 ? (int)control.batch : self->upload_batch);
+        LOG("[SSN1] Server set upload interval %lds, batch %d\n", (long)self->upload_interval, self->upload_batch);
+    }
     
     return 0;
 }
 
 /**
- * @Brief: Initializes and allocates the SSN1 structure, sets initial state, and initializes the HTTP client.
+ * @Brief: Returns the milliseconds elapsed between two CLOCK_MONOTONIC timestamps.
+ * @Param: from The earlier timestamp.
+ * @Param: to The later timestamp.
+ * @Return: Elapsed time in milliseconds.
+ */
+static double ssn1_elapsed_ms(const struct timespec *from, const struct timespec *to)
+{
+    return (double)(to->tv_sec - from->tv_sec) * 1e3 + (double)(to->tv_nsec - from->tv_nsec) / 1e6;
+}
+
+/**
+ * @Brief: Callback function executed by the priority HTTP client when an alert has been answered.
+ * @Param: cb_handle Pointer to the embedded http_cb structure.
+ * @Param: response The received server response string.
+ * @Return: 0 on success.
+ */
+static int ssn1_alert_callback(struct http_cb *cb_handle, const char *response)
+{
+    struct ssn1 *self = CONTAINER_OF(cb_handle, struct ssn1, alert_handle);
+    struct http_response parsed;
+
+    self->alert_sending = 0;
+    http_parse_response(response, ssn1_now(self), &parsed);
+    if ((parsed.status < 200 || parsed.status >= 300) && http_status_transient(parsed.status)) 
+    {
+        // Not delivered: the alert stays queued and is sent again once the lane allows it
+        LOG("[SSN1] Alert not accepted by server (%d), keeping it queued\n", parsed.status);
+        return 0;
+    }
+    if (parsed.status < 200 || parsed.status >= 300) 
+    {
+        // Refused for good: resending the same alert cannot help
+        LOG("[SSN1] Alert rejected by server (%d), dropping it\n", parsed.status);
+        if (self->alert_sent_seq == self->alert_seq) self->alert_queued = 0;
+        return 0;
+    }
+
+    // The TCP layer stamps the moment the request left the socket buffer
+    struct tcp *tcp = self->alert_http_ctx->tcp_ctx;
+    LOG("[SSN1] Alert delivered, reading-to-wire latency %.3f ms\n",
+           ssn1_elapsed_ms(&self->alert_detected, &tcp->sent_at));
+
+    self->alerts_sent++;
+    // A newer alert state queued while this one was in flight still has to go out
+    if (self->alert_sent_seq == self->alert_seq) self->alert_queued = 0;
+    return 0;
+}
+
+/**
+ * @Brief: Callback function executed by the UDP transport when the receiver acknowledges datagrams.
+ * @Param: cb_handle Pointer to the embedded tcp_cb structure.
+ * @Param: data The raw ack datagram.
+ * @Param: len The length of the ack datagram.
+ * @Return: 0 on success.
+ */
+static int ssn1_udp_callback(struct tcp_cb *cb_handle, const char *data, size_t len)
+{
+    struct ssn1 *self = CONTAINER_OF(cb_handle, struct ssn1, udp_handle);
+    (void)data;
+    (void)len;
+
+    LOG("[SSN1] UDP ack: receiver has #%u, %u datagram(s) lost\n",
+           self->udp_ctx->acked_seq, self->udp_ctx->lost);
+    return 0;
+}
+
+/**
+ * @Brief: Allocates the SSN1 structure and sets its initial state, without any transport.
  * @Param: self Pointer to the ssn1_t pointer where the allocated structure will be stored.
- * @Return: 0 on success, -1 on failure (memory or HTTP client initialization).
+ * @Return: 0 on success, -1 on memory allocation failure.
  */
-int ssn1_init(struct ssn1 **self)
+static int ssn1_alloc(struct ssn1 **self)
 {
     *self = (struct ssn1 *)calloc(1, sizeof(struct ssn1));
     if (!*self) return -1;
 
-    (*self)->read_cycle_start = time(NULL);
-    (*self)->read_last        = (*self)->read_cycle_start;
+    (*self)->store            = &(*self)->local_store;
+    (*self)->read_last        = time(NULL);
+    (*self)->store->read_cycle_start = (*self)->read_last;
     (*self)->sending          = 0;
+    snprintf((*self)->device_id, sizeof((*self)->device_id), "%s", SSN1_DEVICE_ID);
+    (*self)->seed             = (unsigned int)time(NULL) ^ ((unsigned int)getpid() << 16) ^ (unsigned int)(uintptr_t)*self;
+    stats_reset(&(*self)->store->window);
+    return 0;
+}
+
+/**
+ * @Brief: Initializes and allocates the SSN1 structure, sets initial state, and initializes the HTTP client.
+ * @Param: self Pointer to the ssn1_t pointer where the allocated structure will be stored.
+ * @Return: 0 on success, -1 on failure (memory or HTTP client initialization).
+ */
+int ssn1_init(struct ssn1 **self)
+{
+    if (ssn1_alloc(self) != 0) return -1;
     
     // Initialize HTTP client
     struct http *http;
-    if (http_init(&http, "httpbin.org", "80") != 0) 
+    if (http_init(&http, SSN1_HOST, SSN1_PORT) != 0) 
     {
-        printf("Failed to initialize HTTP client\n");
+        LOG("Failed to initialize HTTP client\n");
         free(*self);
         *self = NULL;
         return -1;
@@ -65,48 +277,795 @@ int ssn1_init(struct ssn1 **self)
     (*self)->http_handle.cb_fn = ssn1_http_callback;
     http_set_callback(http, &(*self)->http_handle, ssn1_http_callback);
 
+    // Initialize the priority lane used for threshold alerts
+    struct http *alert_http;
+    if (http_init(&alert_http, SSN1_HOST, SSN1_PORT) != 0) 
+    {
+        LOG("Failed to initialize alert HTTP client\n");
+        http_dispose(&(*self)->http_ctx);
+        free(*self);
+        *self = NULL;
+        return -1;
+    }
+    (*self)->alert_http_ctx = alert_http;
+    (*self)->alert_handle.cb_fn = ssn1_alert_callback;
+    http_set_callback(alert_http, &(*self)->alert_handle, ssn1_alert_callback);
+
+    return 0;
+}
+
+/**
+ * @Brief: Initializes a node that reports over UDP only. No HTTP clients are created, so uploads and
+ *         alerts both go out as datagrams; this is the lightweight form used by the gateway.
+ * @Param: self Pointer to the ssn1_t pointer where the allocated structure will be stored.
+ * @Param: host The hostname or IP address of the UDP receiver.
+ * @Param: port The port number as a string.
+ * @Param: ack_every Ask the receiver for a cumulative ack every N datagrams, 0 for none.
+ * @Return: 0 on success, -1 on failure (memory or UDP initialization).
+ */
+int ssn1_init_udp(struct ssn1 **self, const char *host, const char *port, int ack_every)
+{
+    if (ssn1_alloc(self) != 0) return -1;
+    if (ssn1_use_udp(*self, host, port, ack_every) != 0) 
+    {
+        free(*self);
+        *self = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @Brief: Attaches a time source and restarts the reading cycle on its time base. The HTTP clients
+ *         follow it too, so upload pacing, holds, backoff and breaker pauses all run on it.
+ * @Param: self Pointer to the initialized ssn1_t structure.
+ * @Param: clock Pointer to an embedded ssn1_clock structure, NULL for the wall clock.
+ * @Return: void
+ */
+void ssn1_set_clock(struct ssn1 *self, struct ssn1_clock *clock)
+{
+    if (!self) return;
+    self->clock            = clock;
+    self->store->read_cycle_start = ssn1_now(self);
+    self->read_last        = self->store->read_cycle_start;
+
+    self->link_clock_handle.now_fn = ssn1_link_clock;
+    http_set_clock(self->http_ctx, clock ? &self->link_clock_handle : NULL);
+    http_set_clock(self->alert_http_ctx, clock ? &self->link_clock_handle : NULL);
+}
+
+/**
+ * @Brief: Attaches a sensor source; the node takes ownership and closes it on dispose.
+ * @Param: self Pointer to the initialized ssn1_t structure.
+ * @Param: source Pointer to an opened source, NULL to return to the built-in simulation.
+ * @Return: void
+ */
+void ssn1_set_source(struct ssn1 *self, struct ssn1_source *source)
+{
+    if (!self) return;
+    if (self->source) source_close(&self->source);
+    self->source     = source;
+    self->sample_pos = 0;
+    self->sample_len = 0;
+    self->source_eof = 0;
+}
+
+/**
+ * @Brief: Seeds the node's jitter: upload holds, the built-in simulated sensor and the retry backoff of both
+ *         HTTP clients. Nodes seeded differently never back off in lockstep; the same seed replays a run.
+ * @Param: self Pointer to the initialized ssn1_t structure.
+ * @Param: seed The seed.
+ * @Return: void
+ */
+void ssn1_set_seed(struct ssn1 *self, unsigned int seed)
+{
+    if (!self) return;
+    self->seed = seed;
+    http_set_seed(self->http_ctx, seed ^ 0x5bd1e995u);
+    http_set_seed(self->alert_http_ctx, seed ^ 0x27d4eb2fu);
+}
+
+/**
+ * @Brief: Sets the device id sent with every upload.
+ * @Param: self Pointer to the initialized ssn1_t structure.
+ * @Param: device_id A unique identifier for the sensor (truncated to CODEC_DEVICE_ID_MAX - 1 bytes).
+ * @Return: void
+ */
+void ssn1_set_device_id(struct ssn1 *self, const char *device_id)
+{
+    if (!self || !device_id) return;
+    snprintf(self->device_id, sizeof(self->device_id), "%s", device_id);
+}
+
+/**
+ * @Brief: Enables or disables sending the per-minute aggregates along with each average.
+ * @Param: self Pointer to the initialized ssn1_t structure.
+ * @Param: enable Non-zero to include min/max/stddev/p95 in uploads.
+ * @Return: void
+ */
+void ssn1_set_upload_stats(struct ssn1 *self, int enable)
+{
+    if (!self) return;
+    self->upload_stats = enable ? 1 : 0;
+}
+
+/**
+ * @Brief: Builds the upload record for the cycle that just completed.
+ * @Param: self Pointer to the ssn1_t structure.
+ * @Param: record Destination record.
+ * @Return: void
+ */
+static void ssn1_make_record(struct ssn1 *self, struct temp_record *record)
+{
+    memset(record, 0, sizeof(*record));
+    record->timestamp      = self->read_last;
+    record->temperature    = self->temp_average;
+    record->threshold_flag = self->th_flag;
+
+    if (self->upload_stats) 
+    {
+        const struct stats_summary *agg = &self->store->log_stats[self->store->log_idx];
+        record->has_stats = 1;
+        record->min       = (float)agg->min;
+        record->max       = (float)agg->max;
+        record->stddev    = (float)agg->stddev;
+        record->p95       = (float)agg->p95;
+    }
+}
+
+/**
+ * @Brief: Configures the report-by-exception policy applied to each minute's average.
+ * @Param: self Pointer to the initialized ssn1_t structure.
+ * @Param: deadband Minimum change from the last sent value that triggers an upload (0 = any change).
+ * @Param: heartbeat Maximum seconds between uploads regardless of change (0 = no heartbeat).
+ * @Return: void
+ */
+void ssn1_set_report_policy(struct ssn1 *self, double deadband, time_t heartbeat)
+{
+    if (!self) return;
+    self->report_deadband  = deadband > 0.0 ? deadband : 0.0;
+    self->report_heartbeat = heartbeat > 0 ? heartbeat : 0;
+}
+
+/**
+ * @Brief: Sets how averages are paced onto the HTTP link. The server can change both through the
+ *         control section of its responses. A batch without an interval would never wait for the batch
+ *         to fill, so it implies an interval of two batches' worth of cycles (capped at SSN1_UPLOAD_INTERVAL_MAX),
+ *         which still bounds the wait when the report policy thins out the averages.
+ * @Param: self Pointer to the initialized ssn1_t structure.
+ * @Param: interval Maximum seconds an average waits in the spool (0 = upload every average, or implied by batch).
+ * @Param: batch Upload as soon as this many averages are waiting (0 = no minimum, capped at CODEC_MAX_BATCH).
+ * @Return: void
+ */
+void ssn1_set_upload_pacing(struct ssn1 *self, time_t interval, int batch)
+{
+    if (!self) return;
+    if (interval < 0) interval = 0;
+    if (batch < 0) batch = 0;
+    if (batch > CODEC_MAX_BATCH) batch = CODEC_MAX_BATCH;
+    self->upload_interval_set = interval;
+    if (interval == 0 && batch > 1) 
+    {
+        interval = (time_t)batch * N_READINGS * 2;
+        LOG("[SSN1] Batch of %d without an interval, averages wait at most %lds\n", batch, (long)interval);
+    }
+    if (interval > SSN1_UPLOAD_INTERVAL_MAX) interval = SSN1_UPLOAD_INTERVAL_MAX;
+    self->upload_interval = interval;
+    self->upload_batch    = batch;
+}
+
+/**
+ * @Brief: Decides whether the current average has to be uploaded under the report policy.
+ * @Param: self Pointer to the ssn1_t structure.
+ * @Param: now The current time.
+ * @Return: 1 if the average should be sent, 0 if it can be suppressed.
+ */
+static int ssn1_should_report(struct ssn1 *self, time_t now)
+{
+    // No policy configured: behave as before and send every average
+    if (self->report_deadband <= 0.0 && self->report_heartbeat <= 0) return 1;
+    if (!self->has_sent) return 1;
+    if (self->th_flag != self->last_sent_flag) return 1;
+    if (self->report_heartbeat > 0 && now - self->last_sent_time >= self->report_heartbeat) return 1;
+
+    double delta = self->temp_average - self->last_sent_value;
+    if (delta < 0) delta = -delta;
+    return delta > self->report_deadband;
+}
+
+/**
+ * @Brief: Takes delivered averages as the reference for the report policy: accepted by the server (HTTP)
+ *         or handed to the kernel (UDP, which has no per-record ack). Spooled averages do not count.
+ * @Param: self Pointer to the ssn1_t structure.
+ * @Param: records The delivered records, in chronological order.
+ * @Param: count Number of records.
+ * @Return: void
+ */
+static void ssn1_mark_sent(struct ssn1 *self, const struct temp_record *records, int count)
+{
+    if (count <= 0) return;
+    const struct temp_record *last = &records[count - 1];
+    self->last_sent_value = last->temperature;
+    self->last_sent_flag  = last->threshold_flag;
+    self->last_sent_time  = last->timestamp;
+    self->has_sent        = 1;
+    self->uploads_sent   += (unsigned long)count;
+}
+
+/**
+ * @Brief: Configures the per-reading alert filter.
+ * @Param: self Pointer to the initialized ssn1_t structure.
+ * @Param: hysteresis How far back inside the thresholds a reading must be to clear an alert.
+ * @Param: min_duration Seconds readings must stay out of range before an alert is raised (0 = first reading).
+ * @Return: void
+ */
+void ssn1_set_alert_policy(struct ssn1 *self, double hysteresis, time_t min_duration)
+{
+    if (!self) return;
+    self->alert_hysteresis   = hysteresis > 0.0 ? hysteresis : 0.0;
+    self->alert_min_duration = min_duration > 0 ? min_duration : 0;
+}
+
+/**
+ * @Brief: Hands a queued alert to the priority lane if it is free. UDP alerts go out immediately.
+ *         An alert stays queued until it was handed to the kernel (UDP) or accepted by the server (HTTP).
+ * @Param: self Pointer to the ssn1_t structure.
+ * @Return: void
+ */
+static void ssn1_alert_dispatch(struct ssn1 *self)
+{
+    if (!self->alert_queued) return;
+
+    if (self->udp_ctx) 
+    {
+        if (udp_send_records(self->udp_ctx, self->device_id, &self->alert_record, 1) != 0) 
+        {
+            return; // Tried again on the next call
+        }
+        struct timespec sent;
+        ssn1_stamp(self, &sent);
+        LOG("[SSN1] Alert sent over UDP, reading-to-wire latency %.3f ms\n",
+               ssn1_elapsed_ms(&self->alert_detected, &sent));
+        self->alerts_sent++;
+        self->alert_queued = 0;
+        return;
+    }
+
+    // A newer alert state replaces the queued one; it is sent once the previous alert
+    // completes and the lane's retry policy allows another attempt
+    if (self->alert_sending || !http_ready(self->alert_http_ctx)) return;
+
+    if (http_send_temp_data(self->alert_http_ctx, self->device_id, self->alert_record.timestamp,
+                            self->alert_record.temperature, self->alert_record.threshold_flag) != 0) 
+    {
+        LOG("[SSN1] Failed to initiate alert send\n");
+        return;
+    }
+    self->alert_sending  = 1;
+    self->alert_sent_seq = self->alert_seq;
+}
+
+/**
+ * @Brief: Runs a single reading through the alert filter and queues an alert on a state change.
+ * @Param: self Pointer to the ssn1_t structure.
+ * @Param: read The reading just taken.
+ * @Param: now The time of the reading.
+ * @Return: 1 if an alert was raised, 0 otherwise.
+ */
+static int ssn1_check_alert(struct ssn1 *self, double read, time_t now)
+{
+    int out_of_range = read < self->low_th_warning || read > self->high_th_warning;
+
+    if (!self->alert_active) 
+    {
+        if (!out_of_range) 
+        {
+            self->alert_pending_since = 0;
+            return 0;
+        }
+        if (self->alert_pending_since == 0) self->alert_pending_since = now;
+        if (now - self->alert_pending_since < self->alert_min_duration) return 0;
+        self->alert_active = 1;
+    }
+    else 
+    {
+        // Only clear once the reading is back inside the band by the hysteresis margin
+        if (read < self->low_th_warning + self->alert_hysteresis 
+             || read > self->high_th_warning - self->alert_hysteresis) 
+        {
+            return 0;
+        }
+        self->alert_active        = 0;
+        self->alert_pending_since = 0;
+    }
+
+    ssn1_stamp(self, &self->alert_detected);
+    self->alert_record.timestamp      = now;
+    self->alert_record.temperature    = read;
+    self->alert_record.threshold_flag = self->alert_active;
+    self->alert_queued                = 1;
+    self->alert_seq++;
+    LOG("[SSN1] Alert %s at %.2f°C\n", self->alert_active ? "raised" : "cleared", read);
+
+    ssn1_alert_dispatch(self);
+    return self->alert_active;
+}
+
+/**
+ * @Brief: Appends records to the spool, dropping the oldest ones when it is full.
+ * @Param: self Pointer to the ssn1_t structure.
+ * @Param: records Records to append, in chronological order.
+ * @Param: count Number of records.
+ * @Return: void
+ */
+static void ssn1_spool(struct ssn1 *self, const struct temp_record *records, int count)
+{
+    for (int i = 0; i < count; i++) 
+    {
+        if (self->spool_count == CODEC_MAX_BATCH) 
+        {
+            memmove(self->spool, self->spool + 1, (CODEC_MAX_BATCH - 1) * sizeof(self->spool[0]));
+            self->spool_count--;
+            self->spool_dropped++;
+        }
+        self->spool[self->spool_count++] = records[i];
+    }
+}
+
+/**
+ * @Brief: Puts the records of a failed upload back in front of the spool so they are retried first.
+ * @Param: self Pointer to the ssn1_t structure.
+ * @Return: void
+ */
+static void ssn1_requeue_inflight(struct ssn1 *self)
+{
+    struct temp_record spooled[CODEC_MAX_BATCH];
+    int n_spooled = self->spool_count;
+    memcpy(spooled, self->spool, n_spooled * sizeof(spooled[0]));
+
+    self->spool_count = 0;
+    ssn1_spool(self, self->inflight, self->inflight_count);
+    ssn1_spool(self, spooled, n_spooled);
+    self->inflight_count = 0;
+}
+
+/**
+ * @Brief: Sends everything in the spool as one batch if the HTTP link is idle and allowed by its retry policy.
+ * @Param: self Pointer to the ssn1_t structure.
+ * @Return: void
+ */
+static void ssn1_flush_spool(struct ssn1 *self)
+{
+    if (self->sending || self->spool_count == 0) return;
+
+    // Server pacing: honour any hold, then wait for a full batch or the interval to run out.
+    // A full spool always goes out so pacing never costs data.
+    time_t now = ssn1_now(self);
+    if (now < self->upload_hold_until) return;
+    int batch = self->upload_batch > 0 ? self->upload_batch : CODEC_MAX_BATCH;
+    if (self->spool_count < batch && self->spool_count < CODEC_MAX_BATCH 
+        && now - self->last_upload_time < self->upload_interval) return;
+
+    if (!http_ready(self->http_ctx)) return;
+
+    if (http_send_temp_batch(self->http_ctx, self->device_id, self->spool, self->spool_count) != 0) 
+    {
+        LOG("[SSN1] Failed to initiate HTTP send\n");
+        return;
+    }
+
+    memcpy(self->inflight, self->spool, self->spool_count * sizeof(self->spool[0]));
+    self->inflight_count   = self->spool_count;
+    self->spool_count      = 0;
+    self->sending          = 1;
+    self->last_upload_time = now;
+}
+
+/**
+ * @Brief: Folds a byte range into an FNV-1a hash.
+ * @Param: hash The running hash (2166136261 to start).
+ * @Param: data The bytes to add.
+ * @Param: len The number of bytes.
+ * @Return: The updated hash.
+ */
+static uint32_t ssn1_fnv(uint32_t hash, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    for (size_t i = 0; i < len; i++) 
+    {
+        hash ^= p[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @Brief: Computes the check of one log slot: its average and aggregates.
+ * @Param: store Pointer to the ssn1_store structure.
+ * @Param: idx The slot.
+ * @Return: The 32-bit check.
+ */
+static uint32_t ssn1_slot_check(const struct ssn1_store *store, int idx)
+{
+    uint32_t hash = ssn1_fnv(2166136261u, &store->log[idx], sizeof(store->log[idx]));
+    return ssn1_fnv(hash, &store->log_stats[idx], sizeof(store->log_stats[idx]));
+}
+
+/**
+ * @Brief: Computes the check of a commit record.
+ * @Param: commit Pointer to the commit record.
+ * @Return: The 32-bit check.
+ */
+static uint32_t ssn1_commit_check(const struct ssn1_commit *commit)
+{
+    uint32_t hash = ssn1_fnv(2166136261u, &commit->seq, sizeof(commit->seq));
+    return ssn1_fnv(hash, &commit->log_idx, sizeof(commit->log_idx));
+}
+
+/**
+ * @Brief: Returns the newest valid commit record of a snapshot.
+ * @Param: store Pointer to the mapped ssn1_store structure.
+ * @Return: The commit record, NULL if neither is valid.
+ */
+static const struct ssn1_commit *ssn1_last_commit(const struct ssn1_store *store)
+{
+    const struct ssn1_commit *best = NULL;
+    for (int i = 0; i < 2; i++) 
+    {
+        const struct ssn1_commit *c = &store->commit[i];
+        if (c->seq == 0 || c->check != ssn1_commit_check(c)) continue;
+        if (c->log_idx < 0 || c->log_idx >= LOG_24_HOUR) continue;
+        if (!best || c->seq > best->seq) best = c;
+    }
+    return best;
+}
+
+// The snapshot is the store written raw, so its size must be the sum of its fields
+_Static_assert(sizeof(struct ssn1_store) == 4 * sizeof(uint32_t) + 2 * sizeof(struct ssn1_commit)
+               + LOG_24_HOUR * (sizeof(double) + sizeof(struct stats_summary) + sizeof(uint32_t))
+               + 2 * sizeof(int32_t) + sizeof(int64_t) + sizeof(double) + sizeof(struct stats_window),
+               "ssn1_store must not contain padding");
+
+/**
+ * @Brief: Schedules write-back of the snapshot's dirty pages without waiting for the disk.
+ * @Param: self Pointer to the ssn1_t structure.
+ * @Return: void
+ */
+static void ssn1_snapshot_sync(struct ssn1 *self)
+{
+    if (!self->snapshot_len) return;
+    msync(self->store, self->snapshot_len, MS_ASYNC);
+}
+
+/**
+ * @Brief: Writes the pages holding a range of the snapshot to disk and waits for them.
+ * @Param: data Start of the range inside the mapping.
+ * @Param: len Length of the range.
+ * @Return: void
+ */
+static void ssn1_snapshot_flush(const void *data, size_t len)
+{
+    uintptr_t page  = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t)data & ~(page - 1);
+    uintptr_t end   = (uintptr_t)data + len;
+    if (msync((void *)start, end - start, MS_SYNC) < 0) 
+    {
+        LOG("[SSN1] Failed to flush snapshot: %s\n", strerror(errno));
+    }
+}
+
+/**
+ * @Brief: Seals a log slot that was just written and commits the current log index. The sealed slot is on disk
+ *         before the commit goes to the older of the two records, so a crash or power loss at any point leaves
+ *         one valid commit.
+ * @Param: self Pointer to the ssn1_t structure.
+ * @Param: slot The log slot written this cycle.
+ * @Return: void
+ */
+static void ssn1_snapshot_commit(struct ssn1 *self, int slot)
+{
+    if (!self->snapshot_len) return;
+    struct ssn1_store *store = self->store;
+    store->log_check[slot] = ssn1_slot_check(store, slot);
+
+    // A fence only orders the writes in memory; the disk may take pages in any order, so wait for the slot
+    ssn1_snapshot_flush(&store->log[slot], sizeof(store->log[slot]));
+    ssn1_snapshot_flush(&store->log_stats[slot], sizeof(store->log_stats[slot]));
+    ssn1_snapshot_flush(&store->log_check[slot], sizeof(store->log_check[slot]));
+
+    const struct ssn1_commit *last = ssn1_last_commit(store);
+    uint64_t seq = last ? last->seq + 1 : 1;
+    struct ssn1_commit *next = &store->commit[seq & 1];
+    next->seq     = seq;
+    next->log_idx = store->log_idx;
+    next->check   = ssn1_commit_check(next);
+    ssn1_snapshot_sync(self);
+}
+
+/**
+ * @Brief: Moves a snapshot file that failed validation aside to <path>.bad, replacing any older copy,
+ *         so its history is kept for inspection instead of being overwritten.
+ * @Param: path Path to the snapshot file.
+ * @Return: 0 on success, -1 on failure.
+ */
+static int ssn1_snapshot_quarantine(const char *path)
+{
+    char bad[4096];
+    if (snprintf(bad, sizeof(bad), "%s.bad", path) >= (int)sizeof(bad)) return -1;
+    if (rename(path, bad) < 0) 
+    {
+        LOG("[SSN1] Failed to move invalid snapshot %s aside\n", path);
+        return -1;
+    }
+    LOG("[SSN1] Snapshot %s failed validation, kept as %s\n", path, bad);
+    return 0;
+}
+
+/**
+ * @Brief: Checks that a mapped file is a snapshot this build can attach to: magic, version, size and one valid commit.
+ * @Param: snap Pointer to the mapped file.
+ * @Param: len Expected size of the file.
+ * @Return: 1 if valid, 0 otherwise.
+ */
+static int ssn1_snapshot_valid(const struct ssn1_store *snap, size_t len)
+{
+    return snap->magic   == SSN1_SNAPSHOT_MAGIC
+        && snap->version == SSN1_SNAPSHOT_VERSION
+        && snap->size    == len
+        && ssn1_last_commit(snap) != NULL;
+}
+
+/**
+ * @Brief: Backs the log ring and cycle state with a memory-mapped file. A valid snapshot is reattached at its newest
+ *         commit, with any slot whose check fails cleared; an existing file that fails validation is moved to
+ *         <path>.bad and a new snapshot is started from the current state.
+ * @Param: self Pointer to the initialized ssn1_t structure.
+ * @Param: path Path to the snapshot file, created if missing.
+ * @Return: 1 if existing history was reattached, 0 if a new snapshot was started, -1 on failure.
+ */
+int ssn1_attach_snapshot(struct ssn1 *self, const char *path)
+{
+    if (!self || !path) return -1;
+
+    size_t len = sizeof(struct ssn1_store);
+    struct ssn1_store *snap = NULL;
+    int restored = 0;
+
+    // Attach to an existing file first; only a file of the right size is mapped, nothing is resized in place
+    int fd = open(path, O_RDWR);
+    if (fd >= 0) 
+    {
+        struct stat st;
+        if (fstat(fd, &st) < 0) 
+        {
+            close(fd);
+            return -1;
+        }
+        if ((size_t)st.st_size == len) 
+        {
+            void *map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (map == MAP_FAILED) 
+            {
+                LOG("[SSN1] Failed to map snapshot %s\n", path);
+                close(fd);
+                return -1;
+            }
+            snap = (struct ssn1_store *)map;
+            restored = ssn1_snapshot_valid(snap, len);
+        }
+        close(fd);
+
+        if (!restored) 
+        {
+            if (snap) munmap(snap, len);
+            snap = NULL;
+            if (ssn1_snapshot_quarantine(path) != 0) return -1;
+        }
+    }
+
+    if (!snap) 
+    {
+        fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0644);
+        if (fd < 0) 
+        {
+            LOG("[SSN1] Failed to create snapshot %s\n", path);
+            return -1;
+        }
+        if (ftruncate(fd, (off_t)len) < 0) 
+        {
+            LOG("[SSN1] Failed to size snapshot %s\n", path);
+            close(fd);
+            return -1;
+        }
+        void *map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (map == MAP_FAILED) 
+        {
+            LOG("[SSN1] Failed to map snapshot %s\n", path);
+            return -1;
+        }
+        snap = (struct ssn1_store *)map;
+    }
+
+    if (restored) 
+    {
+        // Resume at the newest commit; a slot torn by the crash is cleared rather than trusted
+        snap->log_idx = ssn1_last_commit(snap)->log_idx;
+        int cleared = 0;
+        for (int i = 0; i < LOG_24_HOUR; i++) 
+        {
+            if (snap->log_check[i] == ssn1_slot_check(snap, i)) continue;
+            snap->log[i] = 0.0;
+            memset(&snap->log_stats[i], 0, sizeof(snap->log_stats[i]));
+            snap->log_check[i] = ssn1_slot_check(snap, i);
+            cleared++;
+        }
+
+        // The partial cycle is not covered by the checks; drop it if it does not add up
+        if (snap->read_count < 0 || snap->read_count > N_READINGS 
+             || snap->window.count != (uint64_t)snap->read_count) 
+        {
+            snap->read_count       = 0;
+            snap->read_current_sum = 0.0;
+            snap->read_cycle_start = ssn1_now(self);
+            stats_reset(&snap->window);
+        }
+        LOG("[SSN1] Reattached snapshot %s (log index %d, %d reading(s) in cycle, %d slot(s) cleared)\n",
+               path, snap->log_idx, snap->read_count, cleared);
+    }
+    else 
+    {
+        memcpy(snap, self->store, len);
+        snap->magic   = SSN1_SNAPSHOT_MAGIC;
+        snap->version = SSN1_SNAPSHOT_VERSION;
+        snap->size    = (uint32_t)len;
+        memset(snap->commit, 0, sizeof(snap->commit));
+        for (int i = 0; i < LOG_24_HOUR; i++) snap->log_check[i] = ssn1_slot_check(snap, i);
+        LOG("[SSN1] Started new snapshot %s\n", path);
+    }
+
+    if (self->snapshot_len) munmap(self->store, self->snapshot_len);
+    self->store        = snap;
+    self->snapshot_len = len;
+    self->read_last    = ssn1_now(self);
+    if (!restored) 
+    {
+        // First commit: the new file is not attachable before this point
+        snap->commit[1].seq     = 1;
+        snap->commit[1].log_idx = snap->log_idx;
+        snap->commit[1].check   = ssn1_commit_check(&snap->commit[1]);
+    }
+    ssn1_snapshot_sync(self);
+
+    return restored;
+}
+
+/**
+ * @Brief: Starts publishing the latest reading, average and flags to a shared-memory segment named after the device id.
+ * @Param: self Pointer to the initialized ssn1_t structure.
+ * @Return: 0 on success, -1 on failure (segment could not be created).
+ */
+int ssn1_use_shm(struct ssn1 *self)
+{
+    if (!self) return -1;
+    if (self->shm_ctx) shm_writer_close(&self->shm_ctx);
+    return shm_writer_open(&self->shm_ctx, self->device_id);
+}
+
+/**
+ * @Brief: Publishes the current values to the shared-memory segment, if one is attached.
+ * @Param: self Pointer to the ssn1_t structure.
+ * @Param: now The time of the latest reading.
+ * @Return: void
+ */
+static void ssn1_publish(struct ssn1 *self, time_t now)
+{
+    if (!self->shm_ctx) return;
+
+    struct shm_record record = 
+    {
+        .timestamp    = (int64_t)now,
+        .temp_read    = self->temp_read,
+        .temp_average = self->temp_average,
+        .th_flag      = self->th_flag,
+        .alert_active = self->alert_active
+    };
+    shm_publish(self->shm_ctx, &record);
+}
+
+/**
+ * @Brief: Switches routine uploads from TCP/HTTP to the fire-and-forget UDP transport.
+ * @Param: self Pointer to the initialized ssn1_t structure.
+ * @Param: host The hostname or IP address of the UDP receiver.
+ * @Param: port The port number as a string.
+ * @Param: ack_every Ask the receiver for a cumulative ack every N datagrams, 0 for none.
+ * @Return: 0 on success, -1 on failure (UDP initialization error).
+ */
+int ssn1_use_udp(struct ssn1 *self, const char *host, const char *port, int ack_every)
+{
+    if (!self) return -1;
+
+    struct udp *udp;
+    if (udp_init(&udp, host, port, ack_every) != 0)
+    {
+        LOG("Failed to initialize UDP transport\n");
+        return -1;
+    }
+    if (self->udp_ctx) udp_dispose(&self->udp_ctx);
+    self->udp_ctx = udp;
+
+    // Set up the callback - pass the embedded tcp_cb structure and function pointer
+    self->udp_handle.cb_fn = ssn1_udp_callback;
+    udp_set_callback(udp, &self->udp_handle, ssn1_udp_callback);
+
     return 0;
 }
 
 /**
  * @Brief: The main state machine worker for the sensor node. It handles HTTP transmission and time-based sensor reading/averaging.
  * @Param: self Pointer to the ssn1_t structure.
- * @Return: 0: Nothing ready. 1: Averaging cycle complete and transmission initiated. 2: New reading taken.
+ * @Return: 0: Nothing ready. 1: Averaging cycle complete and transmission initiated. 2: New reading taken. 3: New reading raised an alert.
  */
 int ssn1_work(struct ssn1 *self)
 {
     struct http *http = (struct http *)self->http_ctx;
+    struct ssn1_store *store = self->store;
+
+    // Pick up any pending acks from the datagram transport
+    if (self->udp_ctx) 
+    {
+        udp_work(self->udp_ctx);
+    }
     
-    // If we're in the middle of sending, drive the HTTP state machine
+    // Drive the priority lane first so alerts never wait behind a routine upload
+    if (self->alert_sending) 
+    {
+        if (http_work(self->alert_http_ctx) < 0) 
+        {
+            LOG("[SSN1] Alert transaction failed, keeping it queued\n");
+            self->alert_sending = 0;
+        }
+    }
+    ssn1_alert_dispatch(self);
+
+    // If we're in the middle of sending, drive the HTTP state machine.
+    // Readings carry on meanwhile so alerts are still evaluated.
     if (self->sending) 
     {
         int result = http_work(http);
         if (result == 1) 
         {
             // HTTP transaction complete (callback was called)
-            printf("[SSN1] HTTP transaction complete\n");
+            LOG("[SSN1] HTTP transaction complete\n");
         } 
         else if (result < 0) 
         {
-            printf("[SSN1] HTTP transaction failed\n");
+            LOG("[SSN1] HTTP transaction failed\n");
             self->sending = 0;
+            ssn1_requeue_inflight(self);
         }
-        return 0;
     }
+
+    // Send spooled averages as soon as the link allows it
+    ssn1_flush_spool(self);
     
-    time_t now = time(NULL);
+    time_t now = ssn1_now(self);
     time_t time_since_reading = now - self->read_last;
 
     // Check if it is time to average sum (reading count reached N_READINGS)
-    if (self->read_count >= N_READINGS)
+    if (store->read_count >= N_READINGS)
     {
-        self->temp_average = self->read_current_sum / N_READINGS;
-        printf("\n[SSN1] Average temp over 1 minute: %.2f°C\n", self->temp_average);
-        // Log result and advance idx or flip-over to 0 (circular buffer)
-        self->log[self->log_idx] = self->temp_average;
-        self->log_idx = (self->log_idx + 1) % LOG_24_HOUR;
+        self->temp_average = store->read_current_sum / N_READINGS;
+        LOG("\n[SSN1] Average temp over 1 minute: %.2f°C\n", self->temp_average);
+        // Log result and its aggregates, then advance idx or flip-over to 0 (circular buffer)
+        store->log[store->log_idx] = self->temp_average;
+        stats_summarize(&store->window, &store->log_stats[store->log_idx]);
+        stats_reset(&store->window);
+        const struct stats_summary *agg = &store->log_stats[store->log_idx];
+        LOG("[SSN1] min %.2f / max %.2f / stddev %.3f / p95 %.2f\n",
+               agg->min, agg->max, agg->stddev, agg->p95);
         
-        // Check warning thresholds
+        // Check warning thresholds before anything carries the flag
         if (self->temp_average < self->low_th_warning 
              || self->temp_average > self->high_th_warning)
         {
@@ -116,24 +1075,51 @@ int ssn1_work(struct ssn1 *self)
         {
             self->th_flag = 0;
         }
+        struct temp_record record;
+        ssn1_make_record(self, &record);
+
+        // Close the cycle before committing it, so a restart never replays a logged minute
+        int slot = store->log_idx;
+        store->log_idx          = (slot + 1) % LOG_24_HOUR;
+        store->read_current_sum = 0.0;
+        store->read_count       = 0;
+        store->read_cycle_start = now;
+        self->read_last         = now;
+        ssn1_snapshot_commit(self, slot);
+        ssn1_publish(self, now);
         
-        // Initiate HTTP send with the new data
-        if (http_send_temp_data(http, "SSN1-UUID-12345", 
-                               self->read_last, self->temp_average, self->th_flag) == 0) 
+        if (!ssn1_should_report(self, now)) 
         {
-            self->sending = 1;
-        } 
+            // Still logged above, just not uploaded
+            self->uploads_suppressed++;
+            LOG("[SSN1] Upload suppressed by report policy (%lu suppressed, %lu sent)\n",
+                   self->uploads_suppressed, self->uploads_sent);
+        }
+        else if (self->udp_ctx) 
+        {
+            // Fire-and-forget: one datagram, no connection state to drive
+            if (udp_send_records(self->udp_ctx, self->device_id, &record, 1) == 0) 
+            {
+                ssn1_mark_sent(self, &record, 1);
+            }
+            else 
+            {
+                LOG("[SSN1] Failed to send UDP datagram\n");
+            }
+        }
         else 
         {
-            printf("[SSN1] Failed to initiate HTTP send\n");
+            // Queue behind anything already spooled, then send if the link allows it
+            ssn1_spool(self, &record, 1);
+            ssn1_flush_spool(self);
+            if (self->spool_count > 0) 
+            {
+                static const char *link_names[] = { "closed", "open", "half-open" };
+                LOG("[SSN1] %d average(s) spooled (circuit %s)\n",
+                       self->spool_count, link_names[http_link_state(self->http_ctx)]);
+            }
         }
         
-        // Reset and start timer for the next cycle
-        self->read_current_sum = 0.0;
-        self->read_count       = 0;
-        self->read_cycle_start = now;
-        self->read_last        = now;
-        
         // Signal reading cycle complete to caller
         return 1;
     }
@@ -141,17 +1127,25 @@ int ssn1_work(struct ssn1 *self)
     // Check if it is time to read (at least 1 second passed)
     if (time_since_reading >= 1)
     {
-        double read = ssn1_sensor(self);
+        double read;
+        if (ssn1_sensor(self, &read) != 0) 
+        {
+            // Replay finished, nothing more to read
+            return 0;
+        }
         self->temp_read = read;
-        self->read_current_sum += read;
-        self->read_count++;
+        store->read_current_sum += read;
+        stats_add(&store->window, read);
+        store->read_count++;
         
         // Reset timer
         self->read_last = now;
-        printf("Reading #%d: %.2f°C\n", self->read_count, self->temp_read);
+        LOG("Reading #%d: %.2f°C\n", store->read_count, self->temp_read);
         
-        // Signal reading taken
-        return 2;
+        // Signal reading taken, or that it raised an alert
+        int raised = ssn1_check_alert(self, read, now);
+        ssn1_publish(self, now);
+        return raised ? 3 : 2;
     }
     
     // Signal nothing to do
@@ -166,30 +1160,73 @@ int ssn1_work(struct ssn1 *self)
 int ssn1_dispose(struct ssn1 **self)
 {
     if (!self || !*self) return -1;
-    printf("[SSN1] Disposing sensor...\n");
+    LOG("[SSN1] Disposing sensor...\n");
     // Cleanup HTTP (which will cleanup TCP)
     if ((*self)->http_ctx) 
     {
         http_dispose((struct http **)&(*self)->http_ctx);
     }
+    if ((*self)->alert_http_ctx) 
+    {
+        http_dispose(&(*self)->alert_http_ctx);
+    }
+    if ((*self)->source) 
+    {
+        source_close(&(*self)->source);
+    }
+    if ((*self)->shm_ctx) 
+    {
+        shm_writer_close(&(*self)->shm_ctx);
+    }
+    if ((*self)->snapshot_len) 
+    {
+        ssn1_snapshot_sync(*self);
+        munmap((*self)->store, (*self)->snapshot_len);
+    }
+    if ((*self)->udp_ctx) 
+    {
+        udp_dispose(&(*self)->udp_ctx);
+    }
     // Free the struct
     free(*self);
     *self = NULL;
-    printf("[SSN1] Sensor disposed\n");
+    LOG("[SSN1] Sensor disposed\n");
     return 0;
 }
 
-/* SIMULATING FUNCTION */
+/* SENSOR */
 /**
- * @Brief: Simulates reading temperature from a physical sensor.
+ * @Brief: Takes the next temperature reading. With a source attached, samples come from its current block,
+ *         refilled with one bulk read when used up. Otherwise a physical sensor is simulated.
  * @Param: self Pointer to the ssn1_t structure.
- * @Return: A random double value within a range slightly over the high/low warning thresholds.
+ * @Param: out Destination for the reading.
+ * @Return: 0 on success, -1 when the source is exhausted.
  */
-double ssn1_sensor(struct ssn1 *self)
+static int ssn1_sensor(struct ssn1 *self, double *out)
 {
+    if (self->source) 
+    {
+        if (self->source_eof) return -1;
+        if (self->sample_pos >= self->sample_len) 
+        {
+            int n = source_read(self->source, self->sample_block, SSN1_SAMPLE_BLOCK);
+            if (n <= 0) 
+            {
+                LOG("[SSN1] Sensor source '%s' exhausted\n", self->source->ops->name);
+                self->source_eof = 1;
+                return -1;
+            }
+            self->sample_pos = 0;
+            self->sample_len = n;
+        }
+        *out = self->sample_block[self->sample_pos++];
+        return 0;
+    }
+
+    // Simulated reading: a random value within a range slightly over the high/low warning thresholds
     double low  = self->low_th_warning;
     double high = self->high_th_warning;
-    double norm_rand = (double)rand() / (double)RAND_MAX;
-    double val_in_range = low + (norm_rand * (high - low + 1));
-    return val_in_range;
+    double norm_rand = (double)rand_r(&self->seed) / (double)RAND_MAX;
+    *out = low + (norm_rand * (high - low + 1));
+    return 0;
 }
\ No newline at end of file
@@ -0,0 +1,162 @@
+#include "stats.h"
+#include <math.h>
+#include <string.h>
+
+/**
+ * @Brief: Resets a P² estimator for a target quantile.
+ * @Param: self Pointer to the p2_quantile structure.
+ * @Param: p The quantile to track (0..1).
+ * @Return: void
+ */
+static void p2_reset(struct p2_quantile *self, double p)
+{
+    memset(self, 0, sizeof(*self));
+    self->p = p;
+    for (int i = 0; i < 5; i++) self->n[i] = i;
+    self->np[0] = 0;
+    self->np[1] = 2 * p;
+    self->np[2] = 4 * p;
+    self->np[3] = 2 + 2 * p;
+    self->np[4] = 4;
+    self->dn[0] = 0;
+    self->dn[1] = p / 2;
+    self->dn[2] = p;
+    self->dn[3] = (1 + p) / 2;
+    self->dn[4] = 1;
+}
+
+/**
+ * @Brief: Feeds one observation into a P² estimator.
+ * @Param: self Pointer to the p2_quantile structure.
+ * @Param: x The observation.
+ * @Return: void
+ */
+static void p2_add(struct p2_quantile *self, double x)
+{
+    double *q = self->q, *n = self->n;
+
+    // The first five observations seed the markers (kept sorted)
+    if (self->count < 5)
+    {
+        int i = (int)self->count++;
+        while (i > 0 && q[i - 1] > x)
+        {
+            q[i] = q[i - 1];
+            i--;
+        }
+        q[i] = x;
+        return;
+    }
+    self->count++;
+
+    // Find the cell containing x, stretching the extremes if needed
+    int k;
+    if (x < q[0])
+    {
+        q[0] = x;
+        k = 0;
+    }
+    else if (x >= q[4])
+    {
+        q[4] = x;
+        k = 3;
+    }
+    else
+    {
+        k = 0;
+        while (k < 3 && x >= q[k + 1]) k++;
+    }
+
+    for (int i = k + 1; i < 5; i++) n[i] += 1;
+    for (int i = 0; i < 5; i++) self->np[i] += self->dn[i];
+
+    // Adjust the three middle markers towards their desired positions
+    for (int i = 1; i < 4; i++)
+    {
+        double d = self->np[i] - n[i];
+        if ((d >= 1 && n[i + 1] - n[i] > 1) || (d <= -1 && n[i - 1] - n[i] < -1))
+        {
+            int s = d > 0 ? 1 : -1;
+            double qp = q[i] + s / (n[i + 1] - n[i - 1])
+                      * ((n[i] - n[i - 1] + s) * (q[i + 1] - q[i]) / (n[i + 1] - n[i])
+                       + (n[i + 1] - n[i] - s) * (q[i] - q[i - 1]) / (n[i] - n[i - 1]));
+            if (q[i - 1] < qp && qp < q[i + 1])
+            {
+                q[i] = qp; // Parabolic prediction
+            }
+            else
+            {
+                q[i] = q[i] + s * (q[i + s] - q[i]) / (n[i + s] - n[i]); // Linear fallback
+            }
+            n[i] += s;
+        }
+    }
+}
+
+/**
+ * @Brief: Returns the current estimate of a P² estimator.
+ * @Param: self Pointer to the p2_quantile structure.
+ * @Return: The estimated quantile, exact while fewer than five observations were seen (0 if none).
+ */
+static double p2_value(const struct p2_quantile *self)
+{
+    if (self->count == 0) return 0.0;
+    if (self->count < 5)
+    {
+        int idx = (int)(self->p * (self->count - 1) + 0.5);
+        return self->q[idx];
+    }
+    return self->q[2];
+}
+
+/**
+ * @Brief: Resets a window so the next reading starts a fresh aggregate.
+ * @Param: self Pointer to the stats_window structure.
+ * @Return: void
+ */
+void stats_reset(struct stats_window *self)
+{
+    self->count = 0;
+    self->mean  = 0.0;
+    self->m2    = 0.0;
+    self->min   = 0.0;
+    self->max   = 0.0;
+    p2_reset(&self->p50, 0.50);
+    p2_reset(&self->p95, 0.95);
+}
+
+/**
+ * @Brief: Adds one reading to the window aggregate.
+ * @Param: self Pointer to the stats_window structure.
+ * @Param: x The reading.
+ * @Return: void
+ */
+void stats_add(struct stats_window *self, double x)
+{
+    if (self->count == 0 || x < self->min) self->min = x;
+    if (self->count == 0 || x > self->max) self->max = x;
+
+    self->count++;
+    double delta = x - self->mean;
+    self->mean += delta / (double)self->count;
+    self->m2   += delta * (x - self->mean);
+
+    p2_add(&self->p50, x);
+    p2_add(&self->p95, x);
+}
+
+/**
+ * @Brief: Reduces a window aggregate to its summary values.
+ * @Param: self Pointer to the stats_window structure.
+ * @Param: out Destination summary (all zero for an empty window).
+ * @Return: void
+ */
+void stats_summarize(const struct stats_window *self, struct stats_summary *out)
+{
+    out->mean   = self->mean;
+    out->min    = self->min;
+    out->max    = self->max;
+    out->stddev = self->count > 1 ? sqrt(self->m2 / (double)(self->count - 1)) : 0.0;
+    out->p50    = p2_value(&self->p50);
+    out->p95    = p2_value(&self->p95);
+}
@@ -1,4 +1,5 @@
 #include "tcp.h"
+#include "log.h"
 #include "http.h"
 #include <stdlib.h>
 #include <stdio.h>
@@ -8,6 +9,8 @@
 #include <sys/socket.h>
 #include <netdb.h>
 #include <errno.h>
+#include <time.h>
+#include <stdint.h>
 
 /**
  * @Brief: Sets a socket file descriptor to non-blocking mode.
@@ -21,6 +24,99 @@ static int tcp_set_nonblocking(int sockfd)
     return fcntl(sockfd, F_SETFL, flags | O_NONBLOCK);
 }
 
+/**
+ * @Brief: Reads the client's clock: the attached one, or CLOCK_MONOTONIC if none is set.
+ * @Param: self Pointer to the initialized tcp_t structure.
+ * @Param: out Destination timestamp.
+ * @Return: void
+ */
+static void tcp_time_now(const struct tcp *self, struct timespec *out)
+{
+    if (self->clock && self->clock->now_fn) self->clock->now_fn(self->clock, out);
+    else clock_gettime(CLOCK_MONOTONIC, out);
+}
+
+/**
+ * @Brief: Returns the current time advanced by a number of milliseconds.
+ * @Param: self Pointer to the initialized tcp_t structure.
+ * @Param: out Destination timestamp.
+ * @Param: ms Offset in milliseconds.
+ * @Return: void
+ */
+static void tcp_time_after(const struct tcp *self, struct timespec *out, unsigned ms)
+{
+    tcp_time_now(self, out);
+    out->tv_sec  += ms / 1000;
+    out->tv_nsec += (long)(ms % 1000) * 1000000L;
+    if (out->tv_nsec >= 1000000000L)
+    {
+        out->tv_sec++;
+        out->tv_nsec -= 1000000000L;
+    }
+}
+
+/**
+ * @Brief: Checks whether a deadline has passed on the client's clock.
+ * @Param: self Pointer to the initialized tcp_t structure.
+ * @Param: deadline The timestamp to compare against.
+ * @Return: 1 if the deadline has passed, 0 otherwise.
+ */
+static int tcp_time_reached(const struct tcp *self, const struct timespec *deadline)
+{
+    struct timespec now;
+    tcp_time_now(self, &now);
+    return now.tv_sec > deadline->tv_sec
+        || (now.tv_sec == deadline->tv_sec && now.tv_nsec >= deadline->tv_nsec);
+}
+
+/**
+ * @Brief: Updates the retry policy after a failed request: exponential backoff with full jitter,
+ *         opening the breaker after too many consecutive failures or a failed half-open probe.
+ * @Param: self Pointer to the initialized tcp_t structure.
+ * @Return: void
+ */
+static void tcp_retry_failure(struct tcp *self)
+{
+    struct tcp_retry *r = &self->retry;
+    r->failures++;
+
+    if (r->breaker == TCP_LINK_HALF_OPEN || r->failures >= r->open_after)
+    {
+        // Spread the reopen over an extra half period so a fleet does not probe in lockstep
+        unsigned wait_ms = r->open_ms + (unsigned)(rand_r(&self->seed) % (r->open_ms / 2 + 1));
+        r->breaker    = TCP_LINK_OPEN;
+        r->backoff_ms = 0;
+        tcp_time_after(self, &r->next_attempt, wait_ms);
+        LOG("[TCP] Circuit open after %d failure(s), pausing %u ms\n", r->failures, wait_ms);
+        return;
+    }
+
+    unsigned cap = r->base_ms;
+    for (int i = 1; i < r->failures && cap < r->max_ms; i++) cap *= 2;
+    if (cap > r->max_ms) cap = r->max_ms;
+    r->backoff_ms = cap;
+    unsigned wait_ms = (unsigned)(rand_r(&self->seed) % (cap + 1));
+    tcp_time_after(self, &r->next_attempt, wait_ms);
+    LOG("[TCP] Retry %d backing off %u ms (cap %u ms)\n", r->failures, wait_ms, cap);
+}
+
+/**
+ * @Brief: Resets the retry policy after a successful request.
+ * @Param: self Pointer to the initialized tcp_t structure.
+ * @Return: void
+ */
+static void tcp_retry_success(struct tcp *self)
+{
+    if (self->retry.breaker != TCP_LINK_CLOSED)
+    {
+        LOG("[TCP] Circuit closed\n");
+    }
+    self->retry.failures   = 0;
+    self->retry.backoff_ms = 0;
+    self->retry.breaker    = TCP_LINK_CLOSED;
+    tcp_time_now(self, &self->retry.next_attempt);
+}
+
 /**
  * @Brief: Initializes and allocates a new TCP client structure.
  * @Param: self Pointer to the tcp_t pointer to store the allocated structure.
@@ -33,7 +129,7 @@ int tcp_init(struct tcp **self, const char *host, const char *port)
     *self = (struct tcp *)calloc(1, sizeof(struct tcp));
     if (!*self) 
     {
-        printf("[TCP] Failed to allocate memory\n");
+        LOG("[TCP] Failed to allocate memory\n");
         return -1;
     }
     
@@ -41,8 +137,11 @@ int tcp_init(struct tcp **self, const char *host, const char *port)
     (*self)->port = strdup(port);
     (*self)->sockfd = -1;
     (*self)->state = TCP_STATE_IDLE;
+    // Distinct per client and per process until tcp_set_seed() makes it reproducible
+    (*self)->seed = (unsigned int)time(NULL) ^ ((unsigned int)getpid() << 16) ^ (unsigned int)(uintptr_t)*self;
+    tcp_set_retry_policy(*self, TCP_RETRY_BASE_MS, TCP_RETRY_MAX_MS, TCP_RETRY_OPEN_AFTER, TCP_RETRY_OPEN_MS);
     
-    printf("[TCP] Initialized for %s:%s\n", host, port);
+    LOG("[TCP] Initialized for %s:%s\n", host, port);
     return 0;
 }
 
@@ -60,25 +159,165 @@ void tcp_set_callback(struct tcp *self, struct tcp_cb *cb_handle, tcp_cb_fn fn)
     cb_handle->cb_fn = fn;
 }
 
+/**
+ * @Brief: Keeps the connection open between requests. Responses are delimited with frame_fn
+ *         instead of by the server closing the connection.
+ * @Param: self Pointer to the initialized tcp_t structure.
+ * @Param: frame_fn Framing function for responses, NULL to close after every request (default).
+ * @Return: void
+ */
+void tcp_set_keep_alive(struct tcp *self, tcp_frame_fn frame_fn)
+{
+    if (!self) return;
+    self->frame_fn = frame_fn;
+}
+
+/**
+ * @Brief: Configures the retry policy and resets its state.
+ * @Param: self Pointer to the initialized tcp_t structure.
+ * @Param: base_ms First backoff step in milliseconds.
+ * @Param: max_ms Maximum backoff in milliseconds.
+ * @Param: open_after Consecutive failures that open the circuit breaker.
+ * @Param: open_ms Time the breaker stays open before a half-open probe, in milliseconds.
+ * @Return: void
+ */
+void tcp_set_retry_policy(struct tcp *self, unsigned base_ms, unsigned max_ms, int open_after, unsigned open_ms)
+{
+    if (!self) return;
+    memset(&self->retry, 0, sizeof(self->retry));
+    self->retry.base_ms    = base_ms ? base_ms : 1;
+    self->retry.max_ms     = max_ms > self->retry.base_ms ? max_ms : self->retry.base_ms;
+    self->retry.open_after = open_after > 0 ? open_after : 1;
+    self->retry.open_ms    = open_ms;
+    self->retry.breaker    = TCP_LINK_CLOSED;
+}
+
+/**
+ * @Brief: Seeds the generator behind the retry jitter, so each client of a fleet draws its own sequence
+ *         and a simulation can replay it.
+ * @Param: self Pointer to the initialized tcp_t structure.
+ * @Param: seed The seed.
+ * @Return: void
+ */
+void tcp_set_seed(struct tcp *self, unsigned int seed)
+{
+    if (!self) return;
+    self->seed = seed;
+}
+
+/**
+ * @Brief: Attaches a time source for the retry policy and the sent_at stamp.
+ * @Param: self Pointer to the initialized tcp_t structure.
+ * @Param: clock Pointer to an embedded tcp_clock structure, NULL for CLOCK_MONOTONIC.
+ * @Return: void
+ */
+void tcp_set_clock(struct tcp *self, struct tcp_clock *clock)
+{
+    if (!self) return;
+    self->clock = clock;
+    // A deadline taken on the previous time base means nothing on the new one
+    tcp_time_now(self, &self->retry.next_attempt);
+}
+
+/**
+ * @Brief: Routes requests through an in-memory transport instead of a socket. The retry policy,
+ *         callback and sent_at stamp behave as they do over the network.
+ * @Param: self Pointer to the initialized tcp_t structure.
+ * @Param: transport Pointer to an embedded tcp_transport structure, NULL for real sockets.
+ * @Return: void
+ */
+void tcp_set_transport(struct tcp *self, struct tcp_transport *transport)
+{
+    if (!self) return;
+    if (self->sockfd >= 0) 
+    {
+        close(self->sockfd);
+        self->sockfd = -1;
+    }
+    self->transport = transport;
+}
+
+/**
+ * @Brief: Hands the queued request to the in-memory transport and stores its response.
+ * @Param: self Pointer to the initialized tcp_t structure.
+ * @Return: 0 on success, -1 on a transport failure.
+ */
+static int tcp_do_exchange(struct tcp *self)
+{
+    size_t len = 0;
+    tcp_time_now(self, &self->sent_at);
+    if (self->transport->exchange_fn(self->transport, self->send_buffer, self->send_len,
+                                     self->recv_buffer, sizeof(self->recv_buffer) - 1, &len) != 0) 
+    {
+        LOG("[TCP] Transport failed\n");
+        return -1;
+    }
+    self->sent_bytes = self->send_len;
+    self->recv_bytes = len < sizeof(self->recv_buffer) ? len : sizeof(self->recv_buffer) - 1;
+    self->recv_buffer[self->recv_bytes] = '\0';
+    return 0;
+}
+
+/**
+ * @Brief: Reports whether a new request may be started now. Moves an open breaker to half-open once its pause expired.
+ * @Param: self Pointer to the initialized tcp_t structure.
+ * @Return: 1 if idle and allowed by the retry policy, 0 otherwise.
+ */
+int tcp_ready(struct tcp *self)
+{
+    if (!self || self->state != TCP_STATE_IDLE) return 0;
+    if (!tcp_time_reached(self, &self->retry.next_attempt)) return 0;
+
+    if (self->retry.breaker == TCP_LINK_OPEN)
+    {
+        self->retry.breaker = TCP_LINK_HALF_OPEN;
+        LOG("[TCP] Circuit half-open, next request is a probe\n");
+    }
+    return 1;
+}
+
+/**
+ * @Brief: Returns the circuit breaker state, so callers can decide to spool or batch. Reading it changes
+ *         nothing: an open breaker whose pause has expired is reported as half-open, and only moves
+ *         there when tcp_ready() lets the probe through.
+ * @Param: self Pointer to the initialized tcp_t structure.
+ * @Return: The current tcp_link_t state.
+ */
+tcp_link_t tcp_link_state(const struct tcp *self)
+{
+    if (!self) return TCP_LINK_OPEN;
+    if (self->retry.breaker == TCP_LINK_OPEN && tcp_time_reached(self, &self->retry.next_attempt))
+    {
+        return TCP_LINK_HALF_OPEN;
+    }
+    return self->retry.breaker;
+}
+
 /**
  * @Brief: Queues a data buffer to be sent when the TCP worker runs.
  * @Param: self Pointer to the initialized tcp_t structure.
  * @Param: data The buffer containing the data to send.
  * @Param: len The size of the data buffer in bytes.
- * @Return: 0 on success, -1 if unable to send (e.g., not in IDLE state or memory allocation failure).
+ * @Return: 0 on success, -1 if unable to send (e.g., not in IDLE state, backing off or memory allocation failure).
  */ 
 int tcp_send_request(struct tcp *self, const char *data, size_t len)
 {
     if (!self || self->state != TCP_STATE_IDLE) 
     {
-        printf("[TCP] Cannot send - not in IDLE state (current: %d)\n", self->state);
+        LOG("[TCP] Cannot send - not in IDLE state (current: %d)\n", self ? (int)self->state : -1);
+        return -1;
+    }
+
+    if (!tcp_ready(self)) 
+    {
+        LOG("[TCP] Cannot send - backing off (failures: %d)\n", self->retry.failures);
         return -1;
     }
     
     self->send_buffer = malloc(len);
     if (!self->send_buffer) 
     {
-        printf("[TCP] Failed to allocate send buffer\n");
+        LOG("[TCP] Failed to allocate send buffer\n");
         return -1;
     }
     
@@ -86,10 +325,25 @@ int tcp_send_request(struct tcp *self, const char *data, size_t len)
     self->send_len = len;
     self->sent_bytes = 0;
     self->recv_bytes = 0;
-    memset(self->recv_buffer, 0, sizeof(self->recv_buffer));
+    self->recv_buffer[0] = '\0';
     
     self->state = TCP_STATE_CONNECTING;
-    printf("[TCP] Request queued, %zu bytes\n", len);
+    if (self->sockfd >= 0) 
+    {
+        // Reuse a kept-alive connection unless the server has closed it meanwhile
+        char probe;
+        ssize_t n = recv(self->sockfd, &probe, 1, MSG_PEEK | MSG_DONTWAIT);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) 
+        {
+            self->state = TCP_STATE_SENDING;
+        }
+        else 
+        {
+            close(self->sockfd);
+            self->sockfd = -1;
+        }
+    }
+    LOG("[TCP] Request queued, %zu bytes\n", len);
     
     return 0;
 }
@@ -104,7 +358,7 @@ static int tcp_start_connect(struct tcp *self)
     struct addrinfo hints, *res;
     int ret;
     
-    printf("[TCP] Resolving %s:%s\n", self->host, self->port);
+    LOG("[TCP] Resolving %s:%s\n", self->host, self->port);
     
     memset(&hints, 0, sizeof(hints));
     hints.ai_family = AF_UNSPEC;
@@ -113,21 +367,21 @@ static int tcp_start_connect(struct tcp *self)
     ret = getaddrinfo(self->host, self->port, &hints, &res);
     if (ret != 0) 
     {
-        printf("[TCP] getaddrinfo failed: %s\n", gai_strerror(ret));
+        LOG("[TCP] getaddrinfo failed: %s\n", gai_strerror(ret));
         return -1;
     }
     
     self->sockfd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
     if (self->sockfd < 0) 
     {
-        printf("[TCP] socket failed\n");
+        LOG("[TCP] socket failed\n");
         freeaddrinfo(res);
         return -1;
     }
     
     if (tcp_set_nonblocking(self->sockfd) < 0) 
     {
-        printf("[TCP] Failed to set non-blocking\n");
+        LOG("[TCP] Failed to set non-blocking\n");
         close(self->sockfd);
         self->sockfd = -1;
         freeaddrinfo(res);
@@ -140,7 +394,7 @@ static int tcp_start_connect(struct tcp *self)
     
     if (ret < 0 && errno != EINPROGRESS) 
     {
-        printf("[TCP] connect failed: %s\n", strerror(errno));
+        LOG("[TCP] connect failed: %s\n", strerror(errno));
         close(self->sockfd);
         self->sockfd = -1;
         return -1;
@@ -160,17 +414,17 @@ static int tcp_check_connect(struct tcp *self)
     
     if (getsockopt(self->sockfd, SOL_SOCKET, SO_ERROR, &error, &len) < 0) 
     {
-        printf("[TCP] getsockopt failed\n");
+        LOG("[TCP] getsockopt failed\n");
         return -1;
     }
     
     if (error != 0) 
     {
-        printf("[TCP] Connection failed: %s\n", strerror(error));
+        LOG("[TCP] Connection failed: %s\n", strerror(error));
         return -1;
     }
     
-    printf("[TCP] Connected!\n");
+    LOG("[TCP] Connected!\n");
     return 0;
 }
 
@@ -186,7 +440,7 @@ static int tcp_do_send(struct tcp *self)
         ssize_t sent = send(self->sockfd,
                             self->send_buffer + self->sent_bytes,
                             self->send_len - self->sent_bytes,
-                            MSG_DONTWAIT);
+                            MSG_DONTWAIT | MSG_NOSIGNAL);
         
         if (sent < 0) 
         {
@@ -194,12 +448,12 @@ static int tcp_do_send(struct tcp *self)
             {
                 return 0; // Would block, try again later
             }
-            printf("[TCP] send failed: %s\n", strerror(errno));
+            LOG("[TCP] send failed: %s\n", strerror(errno));
             return -1;
         }
         
         self->sent_bytes += sent;
-        printf("[TCP] Sent %zd bytes (total: %zu/%zu)\n", 
+        LOG("[TCP] Sent %zd bytes (total: %zu/%zu)\n", 
                sent, self->sent_bytes, self->send_len);
     }
     
@@ -209,7 +463,7 @@ static int tcp_do_send(struct tcp *self)
 /**
  * @Brief: Performs non-blocking receiving of data into the receive buffer.
  * @Param: self Pointer to the initialized tcp_t structure.
- * @Return: 1 if the connection was closed by the server (and all data received), 0 if data was received or would block, -1 on a socket error.
+ * @Return: 1 if the response is complete (framed, or the connection was closed by the server), 0 if data was received or would block, -1 on a socket error.
  */ 
 static int tcp_do_recv(struct tcp *self)
 {
@@ -223,19 +477,34 @@ static int tcp_do_recv(struct tcp *self)
         if (errno == EAGAIN || errno == EWOULDBLOCK) {
             return 0; // Would block, try again later
         }
-        printf("[TCP] recv failed: %s\n", strerror(errno));
+        LOG("[TCP] recv failed: %s\n", strerror(errno));
         return -1;
     }
     
     if (received == 0) 
     {
-        printf("[TCP] Connection closed by server\n");
+        LOG("[TCP] Connection closed by server\n");
         self->recv_buffer[self->recv_bytes] = '\0';
-        return 1; // Done receiving
+        self->peer_closed = 1;
+        // A kept-alive connection closed before any response is a failed request
+        return (self->frame_fn && self->recv_bytes == 0) ? -1 : 1;
     }
     
     self->recv_bytes += received;
-    printf("[TCP] Received %zd bytes (total: %zu)\n", received, self->recv_bytes);
+    self->recv_buffer[self->recv_bytes] = '\0';
+    LOG("[TCP] Received %zd bytes (total: %zu)\n", received, self->recv_bytes);
+
+    if (self->frame_fn && self->frame_fn(self->recv_buffer, self->recv_bytes) > 0) 
+    {
+        return 1; // Full response on a persistent connection
+    }
+    if (self->recv_bytes == sizeof(self->recv_buffer) - 1) 
+    {
+        // Keep what fits; the rest is discarded along with the connection
+        LOG("[TCP] Response truncated to %zu bytes\n", self->recv_bytes);
+        self->peer_closed = 1;
+        return 1;
+    }
     
     return 0; // Keep receiving
 }
@@ -243,15 +512,17 @@ static int tcp_do_recv(struct tcp *self)
 /**
  * @Brief: Cleans up socket resources and frees the send buffer.
  * @Param: self Pointer to the initialized tcp_t structure.
+ * @Param: keep_socket Leave the connection open for the next request.
  * @Return: void
  */ 
-static void tcp_cleanup(struct tcp *self)
+static void tcp_cleanup(struct tcp *self, int keep_socket)
 {
-    if (self->sockfd >= 0) 
+    if (self->sockfd >= 0 && !keep_socket) 
     {
         close(self->sockfd);
         self->sockfd = -1;
     }
+    self->peer_closed = 0;
     
     if (self->send_buffer) 
     {
@@ -278,6 +549,11 @@ int tcp_work(struct tcp *self)
             return 0;
             
         case TCP_STATE_CONNECTING:
+            if (self->transport) 
+            {
+                self->state = tcp_do_exchange(self) == 0 ? TCP_STATE_COMPLETE : TCP_STATE_ERROR;
+                return self->state == TCP_STATE_ERROR ? -1 : 0;
+            }
             if (tcp_start_connect(self) != 0) 
             {
                 self->state = TCP_STATE_ERROR;
@@ -305,6 +581,7 @@ int tcp_work(struct tcp *self)
                 } 
                 else if (result == 1) 
                 {
+                    tcp_time_now(self, &self->sent_at);
                     self->state = TCP_STATE_RECEIVING;
                 }
             }
@@ -326,17 +603,24 @@ int tcp_work(struct tcp *self)
             return 0;
             
         case TCP_STATE_COMPLETE:
-            if (self->http_handle && self->http_handle->cb_fn) 
             {
-                self->http_handle->cb_fn(self->http_handle, self->recv_buffer, self->recv_bytes);
+                // The parent judges the response: one it rejects counts as a failed attempt
+                int rejected = 0;
+                if (self->http_handle && self->http_handle->cb_fn) 
+                {
+                    rejected = self->http_handle->cb_fn(self->http_handle, self->recv_buffer, self->recv_bytes) != 0;
+                }
+                tcp_cleanup(self, self->frame_fn && !self->peer_closed);
+                if (rejected) tcp_retry_failure(self);
+                else tcp_retry_success(self);
             }
-            tcp_cleanup(self);
             self->state = TCP_STATE_IDLE;
             return 1;
             
         case TCP_STATE_ERROR:
-            printf("[TCP] Error state, cleaning up\n");
-            tcp_cleanup(self);
+            LOG("[TCP] Error state, cleaning up\n");
+            tcp_cleanup(self, 0);
+            tcp_retry_failure(self);
             self->state = TCP_STATE_IDLE;
             return -1;
     }
@@ -352,11 +636,11 @@ int tcp_work(struct tcp *self)
 int tcp_dispose(struct tcp **self)
 {
     if (!self || !*self) return -1;
-    tcp_cleanup(*self);
+    tcp_cleanup(*self, 0);
     if ((*self)->host) free((*self)->host);
     if ((*self)->port) free((*self)->port);
     free(*self);
     *self = NULL;
-    printf("[TCP] Disposed\n");
+    LOG("[TCP] Disposed\n");
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,462 @@
+#include "udp.h"
+#include "log.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <errno.h>
+#include <time.h>
+#include <netinet/in.h>
+
+/**
+ * @Brief: Writes a 32-bit value into a buffer in little-endian byte order.
+ * @Param: p Destination buffer (at least 4 bytes).
+ * @Param: v The value to write.
+ * @Return: void
+ */
+static void udp_put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v);
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+/**
+ * @Brief: Reads a little-endian 32-bit value from a buffer.
+ * @Param: p Source buffer (at least 4 bytes).
+ * @Return: The decoded value.
+ */
+static uint32_t udp_get_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * @Brief: Picks a sender epoch from the wall clock, the process id and the structure's address,
+ *         so instances started in the same second, or in the same process, still differ.
+ * @Param: self Pointer to the udp_t structure being initialized.
+ * @Return: A non-zero epoch.
+ */
+static uint32_t udp_new_epoch(const struct udp *self)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    uint64_t x = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+    x ^= ((uint64_t)getpid() << 32) ^ (uint64_t)(uintptr_t)self;
+    // splitmix64 finalizer
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    uint32_t epoch = (uint32_t)(x ^ (x >> 32));
+    return epoch ? epoch : 1;
+}
+
+/**
+ * @Brief: Resolves host/port and creates a non-blocking datagram socket, either connected or bound.
+ * @Param: host The hostname or IP address.
+ * @Param: port The port number as a string.
+ * @Param: bind_local Non-zero to bind to the address (receiver), zero to connect to it (sender).
+ * @Return: The socket file descriptor, -1 on failure.
+ */
+static int udp_open_socket(const char *host, const char *port, int bind_local)
+{
+    struct addrinfo hints, *res;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_flags    = bind_local ? AI_PASSIVE : 0;
+
+    int ret = getaddrinfo(host, port, &hints, &res);
+    if (ret != 0)
+    {
+        LOG("[UDP] getaddrinfo failed: %s\n", gai_strerror(ret));
+        return -1;
+    }
+
+    int sockfd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (sockfd < 0)
+    {
+        LOG("[UDP] socket failed\n");
+        freeaddrinfo(res);
+        return -1;
+    }
+
+    int flags = fcntl(sockfd, F_GETFL, 0);
+    if (flags < 0 || fcntl(sockfd, F_SETFL, flags | O_NONBLOCK) < 0)
+    {
+        LOG("[UDP] Failed to set non-blocking\n");
+        close(sockfd);
+        freeaddrinfo(res);
+        return -1;
+    }
+
+    ret = bind_local ? bind(sockfd, res->ai_addr, res->ai_addrlen)
+                     : connect(sockfd, res->ai_addr, res->ai_addrlen);
+    freeaddrinfo(res);
+
+    if (ret < 0)
+    {
+        LOG("[UDP] %s failed: %s\n", bind_local ? "bind" : "connect", strerror(errno));
+        close(sockfd);
+        return -1;
+    }
+    return sockfd;
+}
+
+/**
+ * @Brief: Initializes and allocates a new UDP sender structure.
+ * @Param: self Pointer to the udp_t pointer to store the allocated structure.
+ * @Param: host The hostname or IP address of the receiver.
+ * @Param: port The port number as a string.
+ * @Param: ack_every Request a cumulative ack every N datagrams, 0 for pure fire-and-forget.
+ * @Return: 0 on success, -1 on failure (e.g., memory allocation error).
+ */
+int udp_init(struct udp **self, const char *host, const char *port, int ack_every)
+{
+    *self = (struct udp *)calloc(1, sizeof(struct udp));
+    if (!*self)
+    {
+        LOG("[UDP] Failed to allocate memory\n");
+        return -1;
+    }
+
+    (*self)->host      = strdup(host);
+    (*self)->port      = strdup(port);
+    (*self)->sockfd    = -1;
+    (*self)->ack_every = ack_every > 0 ? ack_every : 0;
+    (*self)->epoch     = udp_new_epoch(*self);
+
+    LOG("[UDP] Initialized for %s:%s\n", host, port);
+    return 0;
+}
+
+/**
+ * @Brief: Sets the callback executed for every ack received from the receiver.
+ * @Param: self Pointer to the initialized udp_t structure.
+ * @Param: cb_handle Pointer to the embedded tcp_cb structure in the parent.
+ * @Param: fn The callback function pointer.
+ * @Return: void
+ */
+void udp_set_callback(struct udp *self, struct tcp_cb *cb_handle, tcp_cb_fn fn)
+{
+    if (!self) return;
+    self->ack_handle = cb_handle;
+    cb_handle->cb_fn = fn;
+}
+
+/**
+ * @Brief: Packs one or more records into a single datagram and sends it with one syscall.
+ * @Param: self Pointer to the initialized udp_t structure.
+ * @Param: device_id A unique identifier for the sensor.
+ * @Param: records Array of records to send.
+ * @Param: count Number of records; must fit in one datagram (UDP_DGRAM_MAX).
+ * @Return: 0 when the datagram was handed to the kernel, -1 on failure (encoding or socket error).
+ */
+int udp_send_records(struct udp *self, const char *device_id,
+                     const struct temp_record *records, size_t count)
+{
+    if (!self) return -1;
+
+    if (self->sockfd < 0)
+    {
+        self->sockfd = udp_open_socket(self->host, self->port, 0);
+        if (self->sockfd < 0) return -1;
+    }
+
+    uint8_t dgram[UDP_DGRAM_MAX];
+    int body_len = codec_bin_encode(dgram + UDP_HDR_LEN, sizeof(dgram) - UDP_HDR_LEN,
+                                    device_id, records, count);
+    if (body_len < 0)
+    {
+        LOG("[UDP] Failed to encode %zu record(s)\n", count);
+        return -1;
+    }
+
+    uint32_t seq = self->seq + 1;
+    dgram[0] = 'S';
+    dgram[1] = 'U';
+    dgram[2] = UDP_VERSION;
+    dgram[3] = (self->ack_every && seq % self->ack_every == 0) ? UDP_FLAG_ACK_REQ : 0;
+    udp_put_le32(dgram + 4, self->epoch);
+    udp_put_le32(dgram + 8, seq);
+
+    ssize_t sent = send(self->sockfd, dgram, UDP_HDR_LEN + body_len, MSG_DONTWAIT);
+    if (sent < 0)
+    {
+        LOG("[UDP] send failed: %s\n", strerror(errno));
+        return -1;
+    }
+
+    self->seq = seq;
+    if (dgram[3] & UDP_FLAG_ACK_REQ) self->ack_pending = 1;
+    LOG("[UDP] Sent datagram #%u (%zd bytes, %zu record(s))\n", seq, sent, count);
+    return 0;
+}
+
+/**
+ * @Brief: Polls the socket for acks without blocking and reports them through the callback.
+ * @Param: self Pointer to the initialized udp_t structure.
+ * @Return: 1 if an ack was processed, 0 if nothing was pending, -1 on a socket error.
+ */
+int udp_work(struct udp *self)
+{
+    if (!self) return -1;
+    // Only touch the socket while an ack is outstanding, keeping the common path syscall free
+    if (self->sockfd < 0 || !self->ack_pending) return 0;
+
+    ssize_t received = recv(self->sockfd, self->recv_buffer, sizeof(self->recv_buffer), MSG_DONTWAIT);
+    if (received < 0)
+    {
+        // ECONNREFUSED is the ICMP echo of a datagram nobody listened to; it is not fatal.
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ECONNREFUSED) return 0;
+        LOG("[UDP] recv failed: %s\n", strerror(errno));
+        return -1;
+    }
+
+    const uint8_t *p = (const uint8_t *)self->recv_buffer;
+    if (received != UDP_ACK_LEN || p[0] != 'S' || p[1] != 'A' || p[2] != UDP_VERSION)
+    {
+        LOG("[UDP] Ignoring malformed ack (%zd bytes)\n", received);
+        return 0;
+    }
+
+    self->acked_seq   = udp_get_le32(p + 4);
+    self->lost        = udp_get_le32(p + 8);
+    self->ack_pending = 0;
+
+    if (self->ack_handle && self->ack_handle->cb_fn)
+    {
+        self->ack_handle->cb_fn(self->ack_handle, self->recv_buffer, (size_t)received);
+    }
+    return 1;
+}
+
+/**
+ * @Brief: Frees all resources associated with the UDP sender and frees the structure itself.
+ * @Param: self Pointer to the udp_t pointer to be disposed and set to NULL.
+ * @Return: 0 on success, -1 if the pointer is invalid.
+ */
+int udp_dispose(struct udp **self)
+{
+    if (!self || !*self) return -1;
+    if ((*self)->sockfd >= 0) close((*self)->sockfd);
+    if ((*self)->host) free((*self)->host);
+    if ((*self)->port) free((*self)->port);
+    free(*self);
+    *self = NULL;
+    LOG("[UDP] Disposed\n");
+    return 0;
+}
+
+/* RECEIVER */
+/**
+ * @Brief: Initializes a UDP receiver bound to a local address.
+ * @Param: self Pointer to the udp_rx_t pointer to store the allocated structure.
+ * @Param: bind_host Local address to bind to (e.g., "127.0.0.1").
+ * @Param: port The port number as a string, "0" picks a free port (see self->port).
+ * @Return: 0 on success, -1 on failure (memory or socket error).
+ */
+int udp_rx_init(struct udp_rx **self, const char *bind_host, const char *port)
+{
+    *self = (struct udp_rx *)calloc(1, sizeof(struct udp_rx));
+    if (!*self)
+    {
+        LOG("[UDP-RX] Failed to allocate memory\n");
+        return -1;
+    }
+
+    (*self)->sockfd = udp_open_socket(bind_host, port, 1);
+    if ((*self)->sockfd < 0)
+    {
+        free(*self);
+        *self = NULL;
+        return -1;
+    }
+
+    struct sockaddr_storage addr;
+    socklen_t addr_len = sizeof(addr);
+    if (getsockname((*self)->sockfd, (struct sockaddr *)&addr, &addr_len) == 0)
+    {
+        (*self)->port = addr.ss_family == AF_INET6
+                      ? ntohs(((struct sockaddr_in6 *)&addr)->sin6_port)
+                      : ntohs(((struct sockaddr_in *)&addr)->sin_port);
+    }
+
+    LOG("[UDP-RX] Listening on %s:%u\n", bind_host, (*self)->port);
+    return 0;
+}
+
+/**
+ * @Brief: Sets the callback executed with the codec payload of every datagram received.
+ * @Param: self Pointer to the initialized udp_rx_t structure.
+ * @Param: cb_handle Pointer to the embedded tcp_cb structure in the parent.
+ * @Param: fn The callback function pointer.
+ * @Return: void
+ */
+void udp_rx_set_callback(struct udp_rx *self, struct tcp_cb *cb_handle, tcp_cb_fn fn)
+{
+    if (!self) return;
+    self->data_handle = cb_handle;
+    cb_handle->cb_fn = fn;
+}
+
+/**
+ * @Brief: Hashes a sender address (FNV-1a over its bytes).
+ * @Param: addr The sender address.
+ * @Param: addr_len Length of the sender address.
+ * @Return: The hash.
+ */
+static uint32_t udp_rx_hash(const struct sockaddr_storage *addr, socklen_t addr_len)
+{
+    const uint8_t *p = (const uint8_t *)addr;
+    uint32_t h = 2166136261u;
+    for (socklen_t i = 0; i < addr_len; i++)
+    {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/**
+ * @Brief: Finds the sequence tracking entry for a sender, adding one on first contact.
+ * @Param: self Pointer to the initialized udp_rx_t structure.
+ * @Param: addr The sender address.
+ * @Param: addr_len Length of the sender address.
+ * @Return: Pointer to the peer entry, NULL on memory allocation failure.
+ */
+static struct udp_rx_peer *udp_rx_peer(struct udp_rx *self, const struct sockaddr_storage *addr, socklen_t addr_len)
+{
+    if ((self->n_peers + 1) * 2 > self->cap_peers)
+    {
+        size_t cap = self->cap_peers ? self->cap_peers * 2 : 64;
+        struct udp_rx_peer **table = calloc(cap, sizeof(*table));
+        if (!table) return NULL;
+        for (size_t i = 0; i < self->cap_peers; i++)
+        {
+            struct udp_rx_peer *peer = self->peers[i];
+            if (!peer) continue;
+            size_t slot = udp_rx_hash(&peer->addr, peer->addr_len) & (cap - 1);
+            while (table[slot]) slot = (slot + 1) & (cap - 1);
+            table[slot] = peer;
+        }
+        free(self->peers);
+        self->peers     = table;
+        self->cap_peers = cap;
+    }
+
+    size_t mask = self->cap_peers - 1;
+    size_t slot = udp_rx_hash(addr, addr_len) & mask;
+    while (self->peers[slot])
+    {
+        struct udp_rx_peer *peer = self->peers[slot];
+        if (peer->addr_len == addr_len && memcmp(&peer->addr, addr, addr_len) == 0) return peer;
+        slot = (slot + 1) & mask;
+    }
+
+    struct udp_rx_peer *peer = calloc(1, sizeof(*peer));
+    if (!peer) return NULL;
+    memcpy(&peer->addr, addr, addr_len);
+    peer->addr_len = addr_len;
+    self->peers[slot] = peer;
+    self->n_peers++;
+    return peer;
+}
+
+/**
+ * @Brief: Drains all pending datagrams, updates loss accounting, answers ack requests and delivers payloads.
+ * @Param: self Pointer to the initialized udp_rx_t structure.
+ * @Return: Number of datagrams processed, -1 on a socket error.
+ */
+int udp_rx_work(struct udp_rx *self)
+{
+    if (!self) return -1;
+
+    int processed = 0;
+    while (1)
+    {
+        struct sockaddr_storage addr;
+        socklen_t addr_len = sizeof(addr);
+        ssize_t received = recvfrom(self->sockfd, self->recv_buffer, sizeof(self->recv_buffer),
+                                    MSG_DONTWAIT, (struct sockaddr *)&addr, &addr_len);
+        if (received < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            LOG("[UDP-RX] recvfrom failed: %s\n", strerror(errno));
+            return -1;
+        }
+
+        const uint8_t *p = (const uint8_t *)self->recv_buffer;
+        if (received < UDP_HDR_LEN || p[0] != 'S' || p[1] != 'U' || p[2] != UDP_VERSION)
+        {
+            LOG("[UDP-RX] Ignoring malformed datagram (%zd bytes)\n", received);
+            continue;
+        }
+
+        struct udp_rx_peer *peer = udp_rx_peer(self, &addr, addr_len);
+        if (!peer) return -1;
+
+        // A new epoch is a (re)started sender whose sequence began at 1, so datagrams before the
+        // first one seen are lost too. Within an epoch, serial-number arithmetic carries the count
+        // across a wrap; anything ahead of expectation is a gap, anything behind is reordered.
+        uint32_t epoch = udp_get_le32(p + 4);
+        uint32_t seq   = udp_get_le32(p + 8);
+        uint32_t gap   = 0;
+        if (epoch != peer->epoch)
+        {
+            peer->epoch = epoch;
+            gap = seq - 1;
+            peer->expected = seq + 1;
+        }
+        else if ((int32_t)(seq - peer->expected) >= 0)
+        {
+            gap = seq - peer->expected;
+            peer->expected = seq + 1;
+        }
+        peer->lost += gap;
+        self->lost += gap;
+        self->received++;
+        processed++;
+
+        if (p[3] & UDP_FLAG_ACK_REQ)
+        {
+            uint8_t ack[UDP_ACK_LEN] = { 'S', 'A', UDP_VERSION, 0 };
+            udp_put_le32(ack + 4, peer->expected - 1);
+            udp_put_le32(ack + 8, peer->lost);
+            if (sendto(self->sockfd, ack, sizeof(ack), MSG_DONTWAIT, (struct sockaddr *)&addr, addr_len) == sizeof(ack))
+            {
+                self->acks_sent++;
+            }
+        }
+
+        if (self->data_handle && self->data_handle->cb_fn)
+        {
+            self->data_handle->cb_fn(self->data_handle, self->recv_buffer + UDP_HDR_LEN,
+                                     (size_t)received - UDP_HDR_LEN);
+        }
+    }
+    return processed;
+}
+
+/**
+ * @Brief: Frees all resources associated with the UDP receiver and frees the structure itself.
+ * @Param: self Pointer to the udp_rx_t pointer to be disposed and set to NULL.
+ * @Return: 0 on success, -1 if the pointer is invalid.
+ */
+int udp_rx_dispose(struct udp_rx **self)
+{
+    if (!self || !*self) return -1;
+    if ((*self)->sockfd >= 0) close((*self)->sockfd);
+    for (size_t i = 0; i < (*self)->cap_peers; i++) free((*self)->peers[i]);
+    free((*self)->peers);
+    free(*self);
+    *self = NULL;
+    LOG("[UDP-RX] Disposed\n");
+    return 0;
+}
@@ -0,0 +1,977 @@
+#define _GNU_SOURCE
+#include "ssn-1.h"
+#include "source.h"
+#include "udp.h"
+#include "shm.h"
+#include "codec.h"
+#include "http.h"
+#include "tcp.h"
+#include "ingest.h"
+#include "log.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <dirent.h>
+
+// Every failed expectation is printed and counted; a case passes when it adds none
+static int check_failures;
+
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) \
+        { \
+            fprintf(stderr, "  FAIL %s:%d: ", __FILE__, __LINE__); \
+            fprintf(stderr, __VA_ARGS__); \
+            fprintf(stderr, "\n"); \
+            check_failures++; \
+        } \
+    } while (0)
+
+/**
+ * @Brief: Returns the milliseconds left until a CLOCK_MONOTONIC deadline (negative once it passed).
+ * @Param: deadline The timestamp to compare against.
+ * @Return: Milliseconds.
+ */
+static double check_ms_until(const struct timespec *deadline)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(deadline->tv_sec - now.tv_sec) * 1e3 + (double)(deadline->tv_nsec - now.tv_nsec) / 1e6;
+}
+
+/**
+ * @Brief: Sleeps for a number of milliseconds.
+ * @Param: ms Milliseconds.
+ * @Return: void
+ */
+static void check_sleep_ms(double ms)
+{
+    if (ms <= 0.0) return;
+    struct timespec ts = { (time_t)(ms / 1e3), (long)((ms - (double)(time_t)(ms / 1e3) * 1e3) * 1e6) };
+    nanosleep(&ts, NULL);
+}
+
+/**
+ * @Brief: Creates a TCP socket bound to a free loopback port without listening on it, so every
+ *         connection is refused until the caller starts listening on it.
+ * @Param: port Destination for the port as a string.
+ * @Param: port_cap Size of the port buffer.
+ * @Return: The socket, -1 on failure.
+ */
+static int check_sink(char *port, size_t port_cap)
+{
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (fd < 0) return -1;
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = 0 };
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        getsockname(fd, (struct sockaddr *)&addr, &len) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    snprintf(port, port_cap, "%u", ntohs(addr.sin_port));
+    return fd;
+}
+
+/**
+ * @Brief: Runs one upload to completion. With a listening sink the request is answered in-line with the
+ *         given status, so client and server share this thread.
+ * @Param: http The client under test.
+ * @Param: sink_fd Listening socket to answer on, -1 when nothing answers.
+ * @Param: status Status code the sink answers with.
+ * @Return: 1 if a response was received, -1 if the request failed, 0 on timeout.
+ */
+static int check_request(struct http *http, int sink_fd, int status)
+{
+    if (http_send_temp_data(http, "SSN1-CHECK", 1700000000, 21.5, 0) != 0) return -1;
+
+    int conn = -1;
+    char request[4096];
+    size_t received = 0;
+    for (int i = 0; i < 20000; i++)
+    {
+        int rv = http_work(http);
+        if (rv != 0)
+        {
+            if (conn >= 0) close(conn);
+            return rv;
+        }
+
+        if (sink_fd >= 0 && conn < 0) conn = accept(sink_fd, NULL, NULL);
+        if (conn >= 0 && received < sizeof(request))
+        {
+            ssize_t n = recv(conn, request + received, sizeof(request) - received, MSG_DONTWAIT);
+            if (n > 0) received += (size_t)n;
+            if (memmem(request, received, "\r\n\r\n", 4))
+            {
+                char response[256];
+                int len = snprintf(response, sizeof(response),
+                                   "HTTP/1.1 %d Check\r\nContent-Length: 2\r\nConnection: close\r\n\r\n{}", status);
+                if (send(conn, response, (size_t)len, MSG_NOSIGNAL) != len) return -1;
+                close(conn);
+                conn = -1;
+                received = sizeof(request); // Answered; ignore the rest of this request
+            }
+        }
+        check_sleep_ms(0.1);
+    }
+    if (conn >= 0) close(conn);
+    return 0;
+}
+
+/**
+ * @Brief: Retry policy against a refusing sink: the backoff cap doubles per failure up to max_ms and the
+ *         actual wait stays within it, the breaker opens after open_after failures, reading the link state
+ *         has no side effect, the half-open probe reopens the breaker on a refusal or a 5xx, and closes it on a 2xx.
+ *         A 4xx that resending cannot fix leaves the link alone.
+ * @Return: void
+ */
+static void check_retry(void)
+{
+    const unsigned base_ms = 20, max_ms = 80, open_ms = 200;
+    const int open_after = 5;
+
+    char port[16];
+    int sink = check_sink(port, sizeof(port));
+    CHECK(sink >= 0, "could not create the sink");
+    if (sink < 0) return;
+
+    struct http *http;
+    if (http_init(&http, "127.0.0.1", port) != 0)
+    {
+        CHECK(0, "http_init failed");
+        close(sink);
+        return;
+    }
+    struct tcp *tcp = http->tcp_ctx;
+    tcp_set_retry_policy(tcp, base_ms, max_ms, open_after, open_ms);
+
+    // Backoff growth: caps 20, 40, 80, 80 while the breaker stays closed
+    unsigned expected_cap = base_ms;
+    for (int i = 1; i < open_after; i++)
+    {
+        while (!http_ready(http)) check_sleep_ms(1);
+        CHECK(check_request(http, -1, 0) < 0, "request %d to the refusing sink did not fail", i);
+        CHECK(tcp->retry.failures == i, "failures %d after %d refusals", tcp->retry.failures, i);
+        CHECK(tcp->retry.backoff_ms == expected_cap, "backoff cap %u ms after %d failures, expected %u",
+              tcp->retry.backoff_ms, i, expected_cap);
+        CHECK(check_ms_until(&tcp->retry.next_attempt) <= (double)expected_cap,
+              "waiting %.1f ms, above the %u ms cap", check_ms_until(&tcp->retry.next_attempt), expected_cap);
+        CHECK(http_link_state(http) == TCP_LINK_CLOSED, "breaker left closed before %d failures", open_after);
+        expected_cap = expected_cap * 2 < max_ms ? expected_cap * 2 : max_ms;
+    }
+
+    // The last allowed failure opens the breaker for open_ms plus up to half of it
+    while (!http_ready(http)) check_sleep_ms(1);
+    CHECK(check_request(http, -1, 0) < 0, "request %d to the refusing sink did not fail", open_after);
+    CHECK(http_link_state(http) == TCP_LINK_OPEN, "breaker not open after %d failures", open_after);
+    double pause = check_ms_until(&tcp->retry.next_attempt);
+    CHECK(pause > open_ms * 0.9 && pause <= open_ms * 1.5, "open pause %.1f ms outside %u..%u ms", pause, open_ms, open_ms * 3 / 2);
+    CHECK(!http_ready(http), "request admitted while the breaker is open");
+
+    // Once the pause expired the state reads half-open, but only tcp_ready() moves the breaker
+    check_sleep_ms(pause + 1.0);
+    CHECK(http_link_state(http) == TCP_LINK_HALF_OPEN, "expired open period not reported as half-open");
+    CHECK(tcp->retry.breaker == TCP_LINK_OPEN, "reading the link state moved the breaker");
+    CHECK(http_ready(http), "half-open probe not admitted");
+    CHECK(tcp->retry.breaker == TCP_LINK_HALF_OPEN, "admitting the probe did not move the breaker to half-open");
+
+    // A refused probe reopens the breaker at once
+    CHECK(check_request(http, -1, 0) < 0, "probe to the refusing sink did not fail");
+    CHECK(http_link_state(http) == TCP_LINK_OPEN, "breaker not reopened by a failed probe");
+
+    // The sink starts answering: a 503 probe is a failure too, a 200 probe closes the breaker
+    CHECK(listen(sink, 16) == 0, "listen failed: %s", strerror(errno));
+    while (!http_ready(http)) check_sleep_ms(1);
+    CHECK(check_request(http, sink, 503) == 1, "no response to the 503 probe");
+    CHECK(http_link_state(http) == TCP_LINK_OPEN, "a 503 answer closed the breaker");
+    CHECK(tcp->retry.failures == open_after + 2, "failures %d after a 503 probe", tcp->retry.failures);
+
+    while (!http_ready(http)) check_sleep_ms(1);
+    CHECK(check_request(http, sink, 200) == 1, "no response to the 200 probe");
+    CHECK(http_link_state(http) == TCP_LINK_CLOSED, "a 200 answer did not close the breaker");
+    CHECK(tcp->retry.failures == 0 && tcp->retry.backoff_ms == 0, "retry state not reset by a 200");
+    CHECK(http_ready(http), "closed breaker does not admit requests");
+
+    // A permanent refusal comes from a reachable server: it is not a failed attempt
+    CHECK(check_request(http, sink, 400) == 1, "no response to the 400 request");
+    CHECK(http_link_state(http) == TCP_LINK_CLOSED && tcp->retry.failures == 0, "a 400 answer counted as a link failure");
+    CHECK(http_ready(http), "a 400 answer held back the next request");
+
+    http_dispose(&http);
+    close(sink);
+}
+
+// Virtual clock plus the records a node delivered to the loopback receiver
+struct check_node
+{
+    struct ssn1_clock clock_handle;
+    struct tcp_cb rx_handle;
+    time_t now;
+    struct temp_record last;
+    int received;
+};
+
+/**
+ * @Brief: Returns the node's virtual time.
+ * @Param: cb_handle Pointer to the embedded ssn1_clock structure.
+ * @Return: The virtual time.
+ */
+static time_t check_node_now(struct ssn1_clock *cb_handle)
+{
+    struct check_node *self = CONTAINER_OF(cb_handle, struct check_node, clock_handle);
+    return self->now;
+}
+
+/**
+ * @Brief: Decodes a datagram from the node and keeps its last record.
+ * @Param: cb_handle Pointer to the embedded tcp_cb structure.
+ * @Param: data The codec payload of the datagram.
+ * @Param: len The length of the payload.
+ * @Return: 0 on success, -1 on a malformed payload.
+ */
+static int check_node_rx(struct tcp_cb *cb_handle, const char *data, size_t len)
+{
+    struct check_node *self = CONTAINER_OF(cb_handle, struct check_node, rx_handle);
+    char device_id[CODEC_DEVICE_ID_MAX];
+    struct temp_record records[CODEC_MAX_BATCH];
+
+    int n = codec_bin_decode((const uint8_t *)data, len, device_id, sizeof(device_id), records, CODEC_MAX_BATCH);
+    if (n <= 0) return -1;
+    self->last = records[n - 1];
+    self->received++;
+    return 0;
+}
+
+/**
+ * @Brief: Threshold flag of each average: a CSV source replays minutes averaging 20, 50 and 20
+ *         against thresholds 15/25, and both the uploaded records and the shared-memory snapshot
+ *         must carry flags 0, 1, 0 for the minute they describe.
+ * @Return: void
+ */
+static void check_threshold(void)
+{
+    static const double averages[] = { 20.0, 50.0, 20.0 };
+    static const int flags[] = { 0, 1, 0 };
+    const int cycles = (int)(sizeof(averages) / sizeof(averages[0]));
+
+    char path[] = "/tmp/ssn1-check-XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0, "could not create the CSV source");
+    if (fd < 0) return;
+    FILE *csv = fdopen(fd, "w");
+    for (int c = 0; c < cycles; c++)
+    {
+        for (int i = 0; i < N_READINGS; i++) fprintf(csv, "%.1f\n", averages[c]);
+    }
+    fclose(csv);
+
+    struct check_node node = { .clock_handle.now_fn = check_node_now, .now = 1700000000 };
+    struct udp_rx *rx = NULL;
+    struct ssn1 *ssn1 = NULL;
+    struct ssn1_source *source = NULL;
+    struct shm_reader *reader = NULL;
+    char port[16], device_id[CODEC_DEVICE_ID_MAX];
+    snprintf(device_id, sizeof(device_id), "SSN1-CHECK-%d", (int)getpid());
+
+    if (udp_rx_init(&rx, "127.0.0.1", "0") != 0 || ssn1_init(&ssn1) != 0 || source_csv_open(&source, path) != 0)
+    {
+        CHECK(0, "setup failed");
+        goto out;
+    }
+    udp_rx_set_callback(rx, &node.rx_handle, check_node_rx);
+    snprintf(port, sizeof(port), "%u", rx->port);
+    ssn1_set_device_id(ssn1, device_id);
+    ssn1_set_clock(ssn1, &node.clock_handle);
+    ssn1_set_source(ssn1, source);
+    source = NULL;
+    ssn1->low_th_warning  = 15.0;
+    ssn1->high_th_warning = 25.0;
+    if (ssn1_use_udp(ssn1, "127.0.0.1", port, 0) != 0 || ssn1_use_shm(ssn1) != 0 ||
+        shm_reader_open(&reader, device_id) != 0)
+    {
+        CHECK(0, "transport setup failed");
+        goto out;
+    }
+
+    // The cycle's own record is the last datagram of the call that completes it; an alert
+    // dispatched at the top of the same call goes out before it
+    int cycle = 0;
+    for (int step = 0; cycle < cycles && step < 10 * N_READINGS * cycles; step++)
+    {
+        int before = node.received;
+        int rv = ssn1_work(ssn1);
+        udp_rx_work(rx);
+        if (rv == 0)
+        {
+            node.now++;
+            continue;
+        }
+        if (rv != 1) continue;
+
+        CHECK(node.received > before, "cycle %d sent no record", cycle + 1);
+        CHECK(node.last.temperature == averages[cycle], "cycle %d record averages %.2f, expected %.2f",
+              cycle + 1, node.last.temperature, averages[cycle]);
+        CHECK(node.last.threshold_flag == flags[cycle], "cycle %d record (avg %.1f) carries flag %d, expected %d",
+              cycle + 1, node.last.temperature, node.last.threshold_flag, flags[cycle]);
+
+        struct shm_record snap;
+        CHECK(shm_read(reader, &snap) == 0, "shm read failed");
+        CHECK(snap.temp_average == averages[cycle] && snap.th_flag == flags[cycle],
+              "cycle %d snapshot shows avg %.2f flag %d, expected %.2f flag %d",
+              cycle + 1, snap.temp_average, snap.th_flag, averages[cycle], flags[cycle]);
+        cycle++;
+    }
+    CHECK(cycle == cycles, "only %d of %d cycles completed", cycle, cycles);
+
+out:
+    if (reader) shm_reader_close(&reader);
+    if (ssn1) ssn1_dispose(&ssn1);
+    if (source) source_close(&source);
+    if (rx) udp_rx_dispose(&rx);
+    unlink(path);
+}
+
+/**
+ * @Brief: Runs a node on a virtual clock until it has completed a number of averaging cycles.
+ * @Param: ssn1 The node.
+ * @Param: node Its clock.
+ * @Param: cycles Number of cycles to complete.
+ * @Return: void
+ */
+static void check_run_cycles(struct ssn1 *ssn1, struct check_node *node, int cycles)
+{
+    for (int step = 0; cycles > 0 && step < 10 * N_READINGS * cycles; step++)
+    {
+        int rv = ssn1_work(ssn1);
+        if (rv == 0) node->now++;
+        if (rv == 1) cycles--;
+    }
+}
+
+/**
+ * @Brief: Opens a node with a seeded simulated sensor, attached to a snapshot file.
+ * @Param: ssn1 Destination for the node.
+ * @Param: node Its clock.
+ * @Param: path Snapshot file.
+ * @Return: The result of ssn1_attach_snapshot(), -1 on setup failure.
+ */
+static int check_snapshot_node(struct ssn1 **ssn1, struct check_node *node, const char *path)
+{
+    struct ssn1_source *source;
+    if (ssn1_init(ssn1) != 0) return -1;
+    if (source_sim_open_seeded(&source, 15.0, 25.0, 7) != 0) return -1;
+    ssn1_set_source(*ssn1, source);
+    ssn1_set_clock(*ssn1, &node->clock_handle);
+    ssn1_set_report_policy(*ssn1, 1000.0, 0); // Keep the check off the network
+    return ssn1_attach_snapshot(*ssn1, path);
+}
+
+/**
+ * @Brief: Snapshot crash safety: a crash after a minute was written but before it was committed reattaches at
+ *         the last commit with the torn slot cleared, and a file that fails validation is kept as <path>.bad
+ *         instead of being overwritten or resized.
+ * @Return: void
+ */
+static void check_snapshot(void)
+{
+    char path[64], bad[80];
+    snprintf(path, sizeof(path), "/tmp/ssn1-check-%d.snap", (int)getpid());
+    snprintf(bad, sizeof(bad), "%s.bad", path);
+    unlink(path);
+    unlink(bad);
+
+    struct check_node node = { .clock_handle.now_fn = check_node_now, .now = 1700000000 };
+    struct ssn1 *ssn1 = NULL;
+    CHECK(check_snapshot_node(&ssn1, &node, path) == 0, "new snapshot not started");
+    check_run_cycles(ssn1, &node, 3);
+    double history[3];
+    memcpy(history, ssn1->store->log, sizeof(history));
+    CHECK(ssn1->store->log_idx == 3, "log index %d after 3 cycles", ssn1->store->log_idx);
+
+    // Crash in the middle of the fourth minute's cycle end: slot written, index advanced, nothing committed
+    ssn1->store->log[3] = 99.0;
+    ssn1->store->log_stats[3].max = 99.0;
+    ssn1->store->log_idx = 4;
+    ssn1_dispose(&ssn1);
+
+    CHECK(check_snapshot_node(&ssn1, &node, path) == 1, "history not reattached after a torn cycle end");
+    if (ssn1)
+    {
+        CHECK(ssn1->store->log_idx == 3, "reattached at log index %d, expected the committed 3", ssn1->store->log_idx);
+        CHECK(memcmp(history, ssn1->store->log, sizeof(history)) == 0, "committed minutes changed across the crash");
+        CHECK(ssn1->store->log[3] == 0.0, "torn slot kept its unsealed value %.1f", ssn1->store->log[3]);
+        check_run_cycles(ssn1, &node, 1);
+        CHECK(ssn1->store->log_idx == 4, "log index %d after one more cycle", ssn1->store->log_idx);
+        ssn1->store->version = 0; // Damage the header
+        ssn1_dispose(&ssn1);
+    }
+
+    // A file that fails validation is moved aside, never overwritten in place
+    struct stat st;
+    CHECK(check_snapshot_node(&ssn1, &node, path) == 0, "damaged snapshot reattached");
+    CHECK(stat(bad, &st) == 0 && (size_t)st.st_size == sizeof(struct ssn1_store), "damaged snapshot not kept as %s", bad);
+    if (ssn1) ssn1_dispose(&ssn1);
+
+    // Neither is a file of the wrong size, e.g. from another build
+    FILE *f = fopen(path, "w");
+    if (f)
+    {
+        fputs("not a snapshot\n", f);
+        fclose(f);
+    }
+    CHECK(check_snapshot_node(&ssn1, &node, path) == 0, "foreign file reattached");
+    CHECK(stat(bad, &st) == 0 && st.st_size == 15, "foreign file not kept as %s", bad);
+    CHECK(stat(path, &st) == 0 && (size_t)st.st_size == sizeof(struct ssn1_store), "new snapshot has the wrong size");
+    if (ssn1) ssn1_dispose(&ssn1);
+
+    unlink(path);
+    unlink(bad);
+}
+
+// In-memory server answering a node's uploads from a script, on the node's virtual clock
+#define CHECK_PACING_REQUESTS 6
+
+struct check_server
+{
+    struct tcp_transport transport_handle;
+    const time_t *now;
+    int requests;
+    time_t at[CHECK_PACING_REQUESTS];
+    int records[CHECK_PACING_REQUESTS];
+};
+
+/**
+ * @Brief: Answers the node's requests in turn: a 503 with Retry-After 120, two transport failures,
+ *         a 200 that sets a batch of 3 and an interval of 300 s, then plain 200s.
+ * @Param: cb_handle Pointer to the embedded tcp_transport structure.
+ * @Param: request The raw request.
+ * @Param: len The length of the request.
+ * @Param: response Destination for the raw response.
+ * @Param: cap Capacity of response.
+ * @Param: response_len Length of the response written.
+ * @Return: 0 if the request was answered, -1 for a transport failure.
+ */
+static int check_server_exchange(struct tcp_transport *cb_handle, const char *request, size_t len,
+                                 char *response, size_t cap, size_t *response_len)
+{
+    struct check_server *self = CONTAINER_OF(cb_handle, struct check_server, transport_handle);
+    static const char *answers[] =
+    {
+        "HTTP/1.1 503 Busy\r\nRetry-After: 120\r\nContent-Length: 0\r\n\r\n",
+        NULL,
+        NULL,
+        "HTTP/1.1 200 OK\r\nContent-Length: 39\r\n\r\n{\"control\":{\"interval\":300,\"batch\":3}}",
+    };
+    int i = self->requests++;
+    if (i >= CHECK_PACING_REQUESTS) return -1;
+
+    char device_id[CODEC_DEVICE_ID_MAX];
+    struct temp_record records[CODEC_MAX_BATCH];
+    const char *body = memmem(request, len, "\r\n\r\n", 4);
+    self->at[i]      = *self->now;
+    self->records[i] = body ? codec_json_decode(body + 4, len - (size_t)(body + 4 - request), device_id, sizeof(device_id),
+                                                records, CODEC_MAX_BATCH) : -1;
+
+    const char *answer = i < (int)(sizeof(answers) / sizeof(answers[0]))
+                       ? answers[i] : "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\n{}";
+    if (!answer) return -1;
+    *response_len = (size_t)snprintf(response, cap, "%s", answer);
+    return 0;
+}
+
+/**
+ * @Brief: Upload cadence on virtual time through an in-memory transport: a 503 holds uploads for its
+ *         Retry-After, a transport failure backs off within the cap, the next one opens the breaker
+ *         for its pause, and a control member paces the uploads that follow into batches of 3. Every
+ *         average is delivered in the end.
+ * @Return: void
+ */
+static void check_pacing(void)
+{
+    char path[] = "/tmp/ssn1-check-XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0, "could not create the CSV source");
+    if (fd < 0) return;
+    FILE *csv = fdopen(fd, "w");
+    for (int i = 0; i < 30 * N_READINGS; i++) fprintf(csv, "20.0\n");
+    fclose(csv);
+
+    struct check_node node = { .clock_handle.now_fn = check_node_now, .now = 1700000000 };
+    struct check_server server = { .transport_handle.exchange_fn = check_server_exchange, .now = &node.now };
+    struct ssn1 *ssn1 = NULL;
+    struct ssn1_source *source = NULL;
+    if (ssn1_init(&ssn1) != 0 || source_csv_open(&source, path) != 0)
+    {
+        CHECK(0, "setup failed");
+        if (ssn1) ssn1_dispose(&ssn1);
+        unlink(path);
+        return;
+    }
+    ssn1_set_clock(ssn1, &node.clock_handle);
+    ssn1_set_source(ssn1, source);
+    ssn1->low_th_warning  = 15.0;
+    ssn1->high_th_warning = 25.0;
+    http_set_transport(ssn1->http_ctx, &server.transport_handle);
+    http_set_transport(ssn1->alert_http_ctx, &server.transport_handle);
+    // The 503 counts as the first failed attempt: the first transport failure then backs off
+    // within a 10 s cap, and the second opens the breaker for 300..450 s
+    tcp_set_retry_policy(ssn1->http_ctx->tcp_ctx, 5000, 10000, 3, 300000);
+
+    for (int step = 0; server.requests < CHECK_PACING_REQUESTS && step < 100 * 30 * N_READINGS; step++)
+    {
+        if (ssn1_work(ssn1) == 0) node.now++;
+    }
+    // Let the node take in the last answer
+    for (int i = 0; ssn1->sending && i < 10; i++) ssn1_work(ssn1);
+    CHECK(server.requests == CHECK_PACING_REQUESTS, "only %d of %d requests made", server.requests, CHECK_PACING_REQUESTS);
+
+    if (server.requests == CHECK_PACING_REQUESTS)
+    {
+        long held = (long)(server.at[1] - server.at[0]);
+        CHECK(held >= 120 && held <= 120 + 12 + 1, "next upload %lds after a 503 with Retry-After 120", held);
+        CHECK(server.records[1] >= 2, "held upload carried %d average(s)", server.records[1]);
+        long backoff = (long)(server.at[2] - server.at[1]);
+        CHECK(backoff <= 10 + 1, "retry %lds after a transport failure, above the 10 s cap", backoff);
+        long paused = (long)(server.at[3] - server.at[2]);
+        CHECK(paused >= 300 && paused <= 450 + 1, "probe %lds after the breaker opened, outside 300..450 s", paused);
+        for (int i = 4; i < CHECK_PACING_REQUESTS; i++)
+        {
+            CHECK(server.records[i] == 3, "paced upload %d carried %d average(s), expected a batch of 3", i + 1, server.records[i]);
+        }
+    }
+    unsigned long delivered = 0;
+    for (int i = 3; i < server.requests && i < CHECK_PACING_REQUESTS; i++) delivered += (unsigned long)server.records[i];
+    CHECK(ssn1->uploads_sent == delivered, "%lu average(s) marked sent, %lu accepted", ssn1->uploads_sent, delivered);
+    CHECK(ssn1->spool_dropped == 0 && ssn1->upload_rejected == 0 && ssn1->spool_count == 0,
+          "averages left behind: %lu dropped, %lu rejected, %d spooled",
+          ssn1->spool_dropped, ssn1->upload_rejected, ssn1->spool_count);
+
+    ssn1_dispose(&ssn1);
+    unlink(path);
+}
+
+/**
+ * @Brief: Fills records with distinct values a JSON round trip keeps exactly (two decimals).
+ * @Param: records Destination.
+ * @Param: count Number of records.
+ * @Param: has_stats Attach window aggregates.
+ * @Return: void
+ */
+static void check_records(struct temp_record *records, int count, int has_stats)
+{
+    for (int i = 0; i < count; i++)
+    {
+        records[i] = (struct temp_record)
+        {
+            .timestamp      = 1700000000 + 60 * i,
+            .temperature    = 15.0 + 0.25 * i,
+            .threshold_flag = i % 2,
+            .has_stats      = has_stats,
+            .min            = 14.5f + 0.25f * (float)i,
+            .max            = 15.5f + 0.25f * (float)i,
+            .stddev         = 0.5f,
+            .p95            = 15.25f + 0.25f * (float)i,
+        };
+    }
+}
+
+/**
+ * @Brief: Compares decoded records against the ones encoded.
+ * @Param: what Label for failure messages.
+ * @Param: got Decoded records.
+ * @Param: want Encoded records.
+ * @Param: count Number of records.
+ * @Return: void
+ */
+static void check_same_records(const char *what, const struct temp_record *got, const struct temp_record *want, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        CHECK(got[i].timestamp == want[i].timestamp && got[i].temperature == want[i].temperature
+              && got[i].threshold_flag == want[i].threshold_flag,
+              "%s record %d decoded as %lld/%.2f/%d, expected %lld/%.2f/%d", what, i,
+              (long long)got[i].timestamp, got[i].temperature, got[i].threshold_flag,
+              (long long)want[i].timestamp, want[i].temperature, want[i].threshold_flag);
+        if (!want[i].has_stats) continue;
+        CHECK(got[i].has_stats && got[i].min == want[i].min && got[i].max == want[i].max
+              && got[i].p95 == want[i].p95, "%s record %d lost its aggregates", what, i);
+    }
+}
+
+/**
+ * @Brief: Builds a JSON batch of CODEC_MAX_BATCH + 1 records by appending a copy of the first record
+ *         to a full encoded batch, since the encoder refuses more.
+ * @Param: buf Destination.
+ * @Param: cap Size of buf.
+ * @Param: device_id The device id.
+ * @Return: Length of the body, -1 on failure.
+ */
+static int check_json_overfull(char *buf, size_t cap, const char *device_id)
+{
+    struct temp_record records[CODEC_MAX_BATCH];
+    check_records(records, CODEC_MAX_BATCH, 0);
+    int len = codec_json_encode(buf, cap, device_id, records, CODEC_MAX_BATCH);
+    if (len < 0) return -1;
+
+    const char *first = strchr(strchr(buf, '['), '{');
+    const char *first_end = strchr(first, '}') + 1;
+    char *tail = strrchr(buf, ']');
+    size_t rec_len = (size_t)(first_end - first), tail_len = strlen(tail);
+    if ((size_t)len + rec_len + 2 >= cap) return -1;
+
+    char record[256];
+    snprintf(record, sizeof(record), "%.*s", (int)rec_len, first);
+    memmove(tail + rec_len + 2, tail, tail_len + 1);
+    memcpy(tail, ", ", 2);
+    memcpy(tail + 2, record, rec_len);
+    return len + (int)rec_len + 2;
+}
+
+/**
+ * @Brief: Codec round trips: JSON and binary batches keep every field, a device id with quotes, backslashes,
+ *         braces, control characters and UTF-8 comes back unchanged, and a batch with more records than the
+ *         caller has room for, or one cut short, is refused instead of silently truncated.
+ * @Return: void
+ */
+static void check_codec(void)
+{
+    static const char *ids[] = { "SSN1-CHECK", "a\"b\\c}{[d]", "tab\there\x01", "caf\xc3\xa9/x" };
+    struct temp_record records[CODEC_MAX_BATCH], decoded[CODEC_MAX_BATCH];
+    char json[CODEC_MAX_BATCH * 256], device_id[CODEC_DEVICE_ID_MAX];
+    uint8_t bin[CODEC_MAX_BATCH * 64];
+
+    for (size_t k = 0; k < sizeof(ids) / sizeof(ids[0]); k++)
+    {
+        check_records(records, 3, (int)(k % 2));
+        int len = codec_json_encode(json, sizeof(json), ids[k], records, 3);
+        CHECK(len > 0, "JSON encode of id %zu failed", k);
+        if (len <= 0) continue;
+        int n = codec_json_decode(json, (size_t)len, device_id, sizeof(device_id), decoded, CODEC_MAX_BATCH);
+        CHECK(n == 3, "JSON decode of id %zu returned %d", k, n);
+        CHECK(strcmp(device_id, ids[k]) == 0, "JSON id %zu came back as \"%s\"", k, device_id);
+        if (n == 3) check_same_records("JSON", decoded, records, 3);
+
+        len = codec_bin_encode(bin, sizeof(bin), ids[k], records, 3);
+        CHECK(len > 0, "binary encode of id %zu failed", k);
+        if (len <= 0) continue;
+        n = codec_bin_decode(bin, (size_t)len, device_id, sizeof(device_id), decoded, CODEC_MAX_BATCH);
+        CHECK(n == 3, "binary decode of id %zu returned %d", k, n);
+        CHECK(strcmp(device_id, ids[k]) == 0, "binary id %zu came back as \"%s\"", k, device_id);
+        if (n == 3) check_same_records("binary", decoded, records, 3);
+    }
+
+    // A full batch fits exactly; one slot short, or one record too many, is an error
+    check_records(records, CODEC_MAX_BATCH, 0);
+    int len = codec_json_encode(json, sizeof(json), "SSN1-CHECK", records, CODEC_MAX_BATCH);
+    CHECK(codec_json_decode(json, (size_t)len, device_id, sizeof(device_id), decoded, CODEC_MAX_BATCH) == CODEC_MAX_BATCH,
+          "full JSON batch not decoded");
+    CHECK(codec_json_decode(json, (size_t)len, device_id, sizeof(device_id), decoded, CODEC_MAX_BATCH - 1) < 0,
+          "JSON batch decoded into too few slots");
+    CHECK(codec_json_decode(json, (size_t)len - 3, device_id, sizeof(device_id), decoded, CODEC_MAX_BATCH) < 0,
+          "unterminated JSON batch decoded");
+    len = check_json_overfull(json, sizeof(json), "SSN1-CHECK");
+    CHECK(len > 0 && codec_json_decode(json, (size_t)len, device_id, sizeof(device_id), decoded, CODEC_MAX_BATCH) < 0,
+          "JSON batch of %d records decoded", CODEC_MAX_BATCH + 1);
+
+    len = codec_bin_encode(bin, sizeof(bin), "SSN1-CHECK", records, CODEC_MAX_BATCH);
+    CHECK(codec_bin_decode(bin, (size_t)len, device_id, sizeof(device_id), decoded, CODEC_MAX_BATCH - 1) < 0,
+          "binary batch decoded into too few slots");
+    CHECK(codec_bin_decode(bin, (size_t)len - 1, device_id, sizeof(device_id), decoded, CODEC_MAX_BATCH) < 0,
+          "truncated binary batch decoded");
+}
+
+/**
+ * @Brief: Sends a raw request to the local server on a new connection and reads one response.
+ * @Param: port The server's port.
+ * @Param: request The raw request.
+ * @Param: len The length of the request.
+ * @Param: closed Set to 1 if the server closed the connection after its response, may be NULL.
+ * @Return: The response status, 0 if no response arrived.
+ */
+static int check_exchange(unsigned short port, const void *request, size_t len, int *closed)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return 0;
+    struct timeval timeout = { 2, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(port) };
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    char response[4096];
+    size_t received = 0;
+    int status = 0;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0 &&
+        send(fd, request, len, MSG_NOSIGNAL) == (ssize_t)len)
+    {
+        while (received < sizeof(response) - 1 && http_response_length(response, received) == 0)
+        {
+            ssize_t n = recv(fd, response + received, sizeof(response) - 1 - received, 0);
+            if (n <= 0) break;
+            received += (size_t)n;
+        }
+        response[received] = '\0';
+        struct http_response parsed;
+        if (http_parse_response(response, time(NULL), &parsed) == 0) status = parsed.status;
+    }
+    if (closed)
+    {
+        char more;
+        timeout.tv_sec = 1;
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        *closed = recv(fd, &more, 1, 0) == 0;
+    }
+    close(fd);
+    return status;
+}
+
+/**
+ * @Brief: Posts a body to the local server on a new connection.
+ * @Param: port The server's port.
+ * @Param: headers Extra header lines, each ending in CRLF.
+ * @Param: body The body.
+ * @Param: body_len The length of the body.
+ * @Return: The response status, 0 if no response arrived.
+ */
+static int check_post(unsigned short port, const char *headers, const void *body, size_t body_len)
+{
+    char request[INGEST_SCRATCH];
+    int len = snprintf(request, sizeof(request), "POST /post HTTP/1.1\r\nHost: check\r\n%sContent-Length: %zu\r\n\r\n",
+                       headers, body_len);
+    if (len < 0 || (size_t)len + body_len > sizeof(request)) return 0;
+    memcpy(request + len, body, body_len);
+    return check_exchange(port, request, (size_t)len + body_len, NULL);
+}
+
+/**
+ * @Brief: Reads every block of a column file.
+ * @Param: path The column file.
+ * @Param: out Destination for the rows; has_stats is set where the aggregates are not NaN.
+ * @Param: max Capacity of out.
+ * @Return: Rows read, -1 if the file is missing or malformed.
+ */
+static int check_col_read(const char *path, struct temp_record *out, int max)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+    int total = 0;
+    struct ingest_col_header hdr;
+    while (fread(&hdr, sizeof(hdr), 1, f) == 1)
+    {
+        if (hdr.magic != INGEST_COL_MAGIC || total + (int)hdr.rows > max) break;
+        int64_t ts[INGEST_BLOCK_ROWS];
+        double temp[INGEST_BLOCK_ROWS];
+        float aggregates[4][INGEST_BLOCK_ROWS];
+        uint8_t flag[INGEST_BLOCK_ROWS];
+        size_t rows = hdr.rows;
+        if (rows > INGEST_BLOCK_ROWS ||
+            fread(ts, sizeof(ts[0]), rows, f) != rows || fread(temp, sizeof(temp[0]), rows, f) != rows ||
+            fread(aggregates[0], sizeof(float), rows, f) != rows || fread(aggregates[1], sizeof(float), rows, f) != rows ||
+            fread(aggregates[2], sizeof(float), rows, f) != rows || fread(aggregates[3], sizeof(float), rows, f) != rows ||
+            fread(flag, 1, rows, f) != rows)
+        {
+            break;
+        }
+        for (size_t i = 0; i < rows; i++)
+        {
+            out[total].timestamp      = (time_t)ts[i];
+            out[total].temperature    = temp[i];
+            out[total].threshold_flag = flag[i];
+            out[total].has_stats      = !isnan(aggregates[0][i]);
+            out[total].min            = aggregates[0][i];
+            out[total].max            = aggregates[1][i];
+            out[total].stddev         = aggregates[2][i];
+            out[total].p95            = aggregates[3][i];
+            total++;
+        }
+        hdr.magic = 0;
+    }
+    int clean = feof(f) || fgetc(f) == EOF;
+    fclose(f);
+    return clean && hdr.magic == 0 ? total : -1;
+}
+
+/**
+ * @Brief: Ingest server end to end: JSON, binary and gzip-compressed batches are stored row for row in
+ *         their device's column file, a batch of more than CODEC_MAX_BATCH records is refused, and a
+ *         Content-Length that is not plain digits, overflows or conflicts with another one is answered
+ *         with 400 and the connection closed; one larger than the server takes gets a 413.
+ * @Return: void
+ */
+static void check_ingest(void)
+{
+    static const char *bad_lengths[] =
+    {
+        "Content-Length: 12x\r\n",
+        "Content-Length: -1\r\n",
+        "Content-Length: +5\r\n",
+        "Content-Length: \r\n",
+        "Content-Length: 99999999999999999999999\r\n",
+        "Content-Length: 2\r\nContent-Length: 3\r\n",
+    };
+    char dir[] = "/tmp/ssn1-check-ingest-XXXXXX";
+    CHECK(mkdtemp(dir) != NULL, "could not create the column directory");
+    struct ingest *ingest = NULL;
+    struct http *http = NULL;
+    if (ingest_init(&ingest, "127.0.0.1", "0", dir, 1) != 0 || ingest_start(ingest) != 0 ||
+        http_init(&http, "127.0.0.1", "0") != 0 || http_set_encoding(http, HTTP_ENCODING_GZIP, 1, -1) != 0)
+    {
+        CHECK(0, "setup failed");
+        goto out;
+    }
+
+    struct temp_record records[CODEC_MAX_BATCH], stored[4 * CODEC_MAX_BATCH];
+    char json[CODEC_MAX_BATCH * 256];
+    uint8_t bin[CODEC_MAX_BATCH * 64], packed[CODEC_MAX_BATCH * 256];
+    check_records(records, 5, 1);
+
+    int len = codec_json_encode(json, sizeof(json), "check/json", records, 5);
+    CHECK(check_post(ingest->port, "Content-Type: " CODEC_CT_JSON "\r\n", json, (size_t)len) == 200, "JSON batch not accepted");
+    len = codec_bin_encode(bin, sizeof(bin), "check-bin", records, 5);
+    CHECK(check_post(ingest->port, "Content-Type: " CODEC_CT_BINARY "\r\n", bin, (size_t)len) == 200, "binary batch not accepted");
+    len = codec_json_encode(json, sizeof(json), "check-gzip", records, 5);
+    int packed_len = http_deflate(http, json, (size_t)len, packed, sizeof(packed));
+    CHECK(packed_len > 0 && check_post(ingest->port, "Content-Type: " CODEC_CT_JSON "\r\nContent-Encoding: gzip\r\n",
+                                       packed, (size_t)packed_len) == 200, "gzip batch not accepted");
+
+    len = check_json_overfull(json, sizeof(json), "check-overfull");
+    CHECK(len > 0 && check_post(ingest->port, "Content-Type: " CODEC_CT_JSON "\r\n", json, (size_t)len) == 400,
+          "batch of %d records not refused with 400", CODEC_MAX_BATCH + 1);
+
+    for (size_t i = 0; i < sizeof(bad_lengths) / sizeof(bad_lengths[0]); i++)
+    {
+        char request[256];
+        int closed = 0;
+        int n = snprintf(request, sizeof(request), "POST /post HTTP/1.1\r\nHost: check\r\n%s\r\n{}", bad_lengths[i]);
+        int status = check_exchange(ingest->port, request, (size_t)n, &closed);
+        CHECK(status == 400 && closed, "bad length %zu answered %d, %s", i, status, closed ? "closed" : "kept open");
+    }
+    {
+        char request[256];
+        int closed = 0;
+        int n = snprintf(request, sizeof(request), "POST /post HTTP/1.1\r\nHost: check\r\nContent-Length: %d\r\n\r\n{}",
+                         INGEST_SCRATCH + 1);
+        int status = check_exchange(ingest->port, request, (size_t)n, &closed);
+        CHECK(status == 413 && closed, "oversized length answered %d, %s", status, closed ? "closed" : "kept open");
+    }
+
+    // Stopping writes out the partly filled blocks
+    ingest_stop(ingest);
+    static const char *files[] = { "check%2Fjson.col", "check-bin.col", "check-gzip.col" };
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++)
+    {
+        char path[128];
+        snprintf(path, sizeof(path), "%s/%s", dir, files[i]);
+        int rows = check_col_read(path, stored, (int)(sizeof(stored) / sizeof(stored[0])));
+        CHECK(rows == 5, "%s holds %d row(s), expected 5", files[i], rows);
+        if (rows == 5) check_same_records(files[i], stored, records, 5);
+    }
+    char path[128];
+    snprintf(path, sizeof(path), "%s/check-overfull.col", dir);
+    CHECK(access(path, F_OK) != 0, "refused batch stored anyway");
+
+out:
+    if (http) http_dispose(&http);
+    if (ingest) ingest_dispose(&ingest);
+    DIR *d = opendir(dir);
+    struct dirent *e;
+    while (d && (e = readdir(d)) != NULL)
+    {
+        if (e->d_name[0] == '.') continue;
+        char entry[512];
+        snprintf(entry, sizeof(entry), "%s/%s", dir, e->d_name);
+        unlink(entry);
+    }
+    if (d) closedir(d);
+    rmdir(dir);
+}
+
+struct check_case
+{
+    const char *name;
+    void (*fn)(void);
+};
+
+static const struct check_case check_cases[] =
+{
+    { "retry",     check_retry },
+    { "threshold", check_threshold },
+    { "snapshot",  check_snapshot },
+    { "pacing",    check_pacing },
+    { "codec",     check_codec },
+    { "ingest",    check_ingest },
+};
+
+/**
+ * @Brief: Prints usage information.
+ * @Param: prog The program name.
+ * @Return: void
+ */
+static void check_usage(const char *prog)
+{
+    fprintf(stderr,
+        "### SSN-1 behaviour checks ###\n"
+        "Drives the library against local sinks and asserts its observable behaviour.\n"
+        "Runs every case, or only the named ones; exits non-zero if any expectation fails.\n"
+        "\n"
+        "Usage: %s [-v] [case...]\n"
+        "  -v  keep the library's diagnostic output\n"
+        "Cases:", prog);
+    for (size_t i = 0; i < sizeof(check_cases) / sizeof(check_cases[0]); i++)
+    {
+        fprintf(stderr, " %s", check_cases[i].name);
+    }
+    fprintf(stderr, "\n");
+}
+
+int main(int argc, char *argv[])
+{
+    int verbose = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "v")) != -1)
+    {
+        switch (opt)
+        {
+            case 'v': verbose = 1; break;
+            default:
+                check_usage(argv[0]);
+                return -1;
+        }
+    }
+    log_set_verbose(verbose);
+
+    int failed_cases = 0, run = 0;
+    for (size_t i = 0; i < sizeof(check_cases) / sizeof(check_cases[0]); i++)
+    {
+        int selected = optind >= argc;
+        for (int a = optind; a < argc; a++)
+        {
+            if (strcmp(argv[a], check_cases[i].name) == 0) selected = 1;
+        }
+        if (!selected) continue;
+
+        int before = check_failures;
+        check_cases[i].fn();
+        run++;
+        int ok = check_failures == before;
+        failed_cases += !ok;
+        fprintf(stderr, "%-12s %s\n", check_cases[i].name, ok ? "ok" : "FAILED");
+    }
+    if (run == 0)
+    {
+        check_usage(argv[0]);
+        return -1;
+    }
+    fprintf(stderr, "%d of %d case(s) passed\n", run - failed_cases, run);
+    return failed_cases ? 1 : 0;
+}
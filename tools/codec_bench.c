@@ -0,0 +1,240 @@
+#include "http.h"
+#include "codec.h"
+#include "log.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <zlib.h>
+
+#define BENCH_BODY_MAX 16384
+
+struct bench_encoding
+{
+    const char *name;
+    http_encoding_t encoding;
+    int level;
+};
+
+static const struct bench_encoding bench_encodings[] =
+{
+    { "identity",  HTTP_ENCODING_IDENTITY, 0 },
+    { "deflate-1", HTTP_ENCODING_DEFLATE,  1 },
+    { "deflate-6", HTTP_ENCODING_DEFLATE,  6 },
+    { "deflate-9", HTTP_ENCODING_DEFLATE,  9 },
+    { "gzip-6",    HTTP_ENCODING_GZIP,     6 },
+};
+
+/**
+ * @Brief: Returns the process CPU time in seconds.
+ * @Return: Seconds as a double.
+ */
+static double bench_cpu_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/**
+ * @Brief: Fills a batch of one-minute averages that wander the way a room sensor does.
+ * @Param: records Destination array.
+ * @Param: count Number of records.
+ * @Param: start Timestamp of the first record.
+ * @Param: with_stats Attach the per-minute aggregates.
+ * @Param: seed Generator state.
+ * @Return: void
+ */
+static void bench_fill(struct temp_record *records, size_t count, time_t start, int with_stats, unsigned int *seed)
+{
+    static double temp = 21.0;
+    for (size_t i = 0; i < count; i++)
+    {
+        temp += ((double)rand_r(seed) / RAND_MAX - 0.5) * 0.2;
+        struct temp_record *r = &records[i];
+        memset(r, 0, sizeof(*r));
+        r->timestamp      = start + (time_t)i * 60;
+        r->temperature    = temp;
+        r->threshold_flag = temp > 25.0;
+        if (with_stats)
+        {
+            r->has_stats = 1;
+            r->min       = (float)(temp - 0.4);
+            r->max       = (float)(temp + 0.4);
+            r->stddev    = (float)(0.15 + (double)rand_r(seed) / RAND_MAX * 0.1);
+            r->p95       = (float)(temp + 0.3);
+        }
+    }
+}
+
+/**
+ * @Brief: Measures the codec on its own: encode and decode cost per operation and per record, JSON and binary.
+ * @Param: iterations Operations per case for a 64-record batch; smaller batches run proportionally more.
+ * @Param: with_stats Attach the per-minute aggregates.
+ * @Param: batches Batch sizes to measure.
+ * @Param: n_batches Number of batch sizes.
+ * @Return: 0 on success, -1 if a body fails to encode or decode.
+ */
+static int bench_codec(int iterations, int with_stats, const size_t *batches, size_t n_batches)
+{
+    static const codec_format_t formats[] = { CODEC_FORMAT_JSON, CODEC_FORMAT_BINARY };
+    struct temp_record records[CODEC_MAX_BATCH];
+    struct temp_record decoded[CODEC_MAX_BATCH];
+    char device_id[CODEC_DEVICE_ID_MAX];
+    char body[BENCH_BODY_MAX];
+
+    printf("%-7s %5s %9s %12s %12s %12s %12s\n",
+           "format", "batch", "bytes", "encode ns/op", "decode ns/op", "enc ns/rec", "dec ns/rec");
+
+    for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++)
+    {
+        int binary = formats[f] == CODEC_FORMAT_BINARY;
+        for (size_t b = 0; b < n_batches; b++)
+        {
+            size_t batch = batches[b];
+            long ops = (long)iterations * CODEC_MAX_BATCH / (long)batch;
+            unsigned int seed = 1;
+            bench_fill(records, batch, 1700000000, with_stats, &seed);
+
+            int len = 0;
+            double t0 = bench_cpu_seconds();
+            for (long i = 0; i < ops; i++)
+            {
+                // Vary one field so the work cannot be hoisted out of the loop
+                records[0].timestamp = 1700000000 + (time_t)(i & 1023) * 60;
+                len = binary ? codec_bin_encode((uint8_t *)body, sizeof(body), "SSN1-UUID-12345", records, batch)
+                             : codec_json_encode(body, sizeof(body), "SSN1-UUID-12345", records, batch);
+                if (len < 0) return -1;
+            }
+            double encode = bench_cpu_seconds() - t0;
+
+            t0 = bench_cpu_seconds();
+            for (long i = 0; i < ops; i++)
+            {
+                int n = binary
+                    ? codec_bin_decode((const uint8_t *)body, (size_t)len, device_id, sizeof(device_id), decoded, CODEC_MAX_BATCH)
+                    : codec_json_decode(body, (size_t)len, device_id, sizeof(device_id), decoded, CODEC_MAX_BATCH);
+                if (n != (int)batch) return -1;
+            }
+            double decode = bench_cpu_seconds() - t0;
+
+            double enc_ns = encode / (double)ops * 1e9;
+            double dec_ns = decode / (double)ops * 1e9;
+            printf("%-7s %5zu %9d %12.0f %12.0f %12.1f %12.1f\n",
+                   binary ? "binary" : "json", batch, len, enc_ns, dec_ns, enc_ns / (double)batch, dec_ns / (double)batch);
+        }
+    }
+    return 0;
+}
+
+/**
+ * @Brief: Prints usage information.
+ * @Param: prog The program name.
+ * @Return: void
+ */
+static void bench_usage(const char *prog)
+{
+    fprintf(stderr,
+        "### SSN-1 upload body benchmark ###\n"
+        "Encodes realistic batches of one-minute averages and compresses them through the HTTP\n"
+        "client's deflate stream, reporting bytes on the wire against CPU time per request.\n"
+        "With -c the encoders and decoders are measured instead, in ns per operation and per record.\n"
+        "\n"
+        "Usage: %s [-n requests per case] [-s] [-c]\n"
+        "  -s  include the per-minute aggregates (min/max/stddev/p95)\n"
+        "  -c  codec mode: JSON and binary encode/decode cost\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+    int iterations = 2000;
+    int with_stats = 0;
+    int codec_only = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:sc")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': iterations = atoi(optarg); break;
+            case 's': with_stats = 1;            break;
+            case 'c': codec_only = 1;            break;
+            default:
+                bench_usage(argv[0]);
+                return -1;
+        }
+    }
+    if (iterations <= 0)
+    {
+        bench_usage(argv[0]);
+        return -1;
+    }
+    log_set_verbose(0);
+
+    static const size_t batches[] = { 1, 5, 15, 60 };
+    static const codec_format_t formats[] = { CODEC_FORMAT_JSON, CODEC_FORMAT_BINARY };
+    if (codec_only) return bench_codec(iterations, with_stats, batches, sizeof(batches) / sizeof(batches[0]));
+
+    size_t n_encodings = sizeof(bench_encodings) / sizeof(bench_encodings[0]);
+
+    struct http *http;
+    if (http_init(&http, "127.0.0.1", "0") != 0) return -1;
+
+    struct temp_record records[CODEC_MAX_BATCH];
+    char body[BENCH_BODY_MAX];
+    char packed[BENCH_BODY_MAX];
+
+    printf("%-7s %5s  %-10s %9s %7s %10s %10s %12s\n",
+           "format", "batch", "encoding", "bytes/req", "ratio", "us/req", "KB/day", "KB saved/CPU-ms");
+
+    for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++)
+    {
+        for (size_t b = 0; b < sizeof(batches) / sizeof(batches[0]); b++)
+        {
+            size_t batch = batches[b];
+            double raw_bytes = 0.0;
+
+            for (size_t e = 0; e < n_encodings; e++)
+            {
+                const struct bench_encoding *enc = &bench_encodings[e];
+                if (http_set_encoding(http, enc->encoding, 1, enc->level) != 0) return -1;
+
+                unsigned int seed = 1;
+                double bytes = 0.0, cpu = 0.0;
+                for (int i = 0; i < iterations; i++)
+                {
+                    bench_fill(records, batch, 1700000000 + (time_t)i * 3600, with_stats, &seed);
+                    int len = formats[f] == CODEC_FORMAT_BINARY
+                        ? codec_bin_encode((uint8_t *)body, sizeof(body), "SSN1-UUID-12345", records, batch)
+                        : codec_json_encode(body, sizeof(body), "SSN1-UUID-12345", records, batch);
+                    if (len < 0) return -1;
+
+                    // Only the compression step is timed; encoding costs the same in every row
+                    if (enc->encoding != HTTP_ENCODING_IDENTITY)
+                    {
+                        double t0 = bench_cpu_seconds();
+                        int packed_len = http_deflate(http, body, (size_t)len, packed, sizeof(packed));
+                        cpu += bench_cpu_seconds() - t0;
+                        if (packed_len > 0 && packed_len < len) len = packed_len;
+                    }
+                    bytes += len;
+                }
+
+                double per_req = bytes / iterations;
+                if (enc->encoding == HTTP_ENCODING_IDENTITY) raw_bytes = per_req;
+                double us = cpu / iterations * 1e6;
+                // A node uploads 1440 averages a day, batch at a time
+                double kb_day = per_req * (1440.0 / (double)batch) / 1024.0;
+                double saved_per_ms = us > 0.0 ? (raw_bytes - per_req) / 1024.0 / (us / 1e3) : 0.0;
+
+                printf("%-7s %5zu  %-10s %9.0f %6.1f%% %10.2f %10.1f %12.1f\n",
+                       formats[f] == CODEC_FORMAT_BINARY ? "binary" : "json", batch, enc->name,
+                       per_req, 100.0 * per_req / raw_bytes, us, kb_day, saved_per_ms);
+            }
+        }
+    }
+
+    http_dispose(&http);
+    return 0;
+}
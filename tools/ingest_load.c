@@ -0,0 +1,189 @@
+#include "ssn-1.h"
+#include "log.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/resource.h>
+
+// One simulated device: an HTTP client on its own keep-alive connection
+struct load_client
+{
+    struct http_cb http_handle;
+    struct http *http_ctx;
+    char device_id[CODEC_DEVICE_ID_MAX];
+    struct timespec sent;
+    unsigned long responses;
+    unsigned long rejected;
+    double latency_ms;
+};
+
+/**
+ * @Brief: Returns CLOCK_MONOTONIC time in seconds.
+ * @Return: Seconds as a double.
+ */
+static double load_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/**
+ * @Brief: HTTP callback counting the answer and its latency.
+ * @Param: cb_handle Pointer to the embedded http_cb structure.
+ * @Param: response The raw response.
+ * @Return: 0 on success.
+ */
+static int load_callback(struct http_cb *cb_handle, const char *response)
+{
+    struct load_client *self = CONTAINER_OF(cb_handle, struct load_client, http_handle);
+    struct http_response parsed;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    if (http_parse_response(response, time(NULL), &parsed) != 0 || parsed.status != 200) self->rejected++;
+    self->responses++;
+    self->latency_ms += (double)(now.tv_sec - self->sent.tv_sec) * 1e3 + (double)(now.tv_nsec - self->sent.tv_nsec) / 1e6;
+    return 0;
+}
+
+/**
+ * @Brief: Prints usage information.
+ * @Param: prog The program name.
+ * @Return: void
+ */
+static void load_usage(const char *prog)
+{
+    fprintf(stderr,
+        "### SSN-1 ingest load generator ###\n"
+        "Drives an ingest server through the node's own HTTP/TCP client, one keep-alive\n"
+        "connection per simulated device.\n"
+        "\n"
+        "Usage: %s [-c connections] [-t seconds] [-B batch] [-f json|binary] [-z deflate|gzip] [-C] [host] [port]\n"
+        "  -z  compress bodies above the default threshold\n"
+        "  -C  close the connection after every request instead of keeping it alive\n"
+        "Example: %s -c 10000 -t 10 -B 16 127.0.0.1 8080\n", prog, prog);
+}
+
+int main(int argc, char *argv[])
+{
+    int    n_clients  = 100;
+    double seconds    = 5.0;
+    int    batch      = 1;
+    int    keep_alive = 1;
+    codec_format_t format = CODEC_FORMAT_JSON;
+    http_encoding_t encoding = HTTP_ENCODING_IDENTITY;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "c:t:B:f:z:C")) != -1)
+    {
+        switch (opt)
+        {
+            case 'c': n_clients  = atoi(optarg);         break;
+            case 't': seconds    = strtod(optarg, NULL); break;
+            case 'B': batch      = atoi(optarg);         break;
+            case 'f': format     = strcmp(optarg, "binary") == 0 ? CODEC_FORMAT_BINARY : CODEC_FORMAT_JSON; break;
+            case 'z': encoding   = strcmp(optarg, "gzip") == 0 ? HTTP_ENCODING_GZIP : HTTP_ENCODING_DEFLATE; break;
+            case 'C': keep_alive = 0;                    break;
+            default:
+                load_usage(argv[0]);
+                return -1;
+        }
+    }
+    const char *host = optind < argc ? argv[optind] : "127.0.0.1";
+    const char *port = optind + 1 < argc ? argv[optind + 1] : "8080";
+    if (n_clients <= 0 || batch <= 0 || batch > CODEC_MAX_BATCH || seconds <= 0.0)
+    {
+        load_usage(argv[0]);
+        return -1;
+    }
+
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    signal(SIGPIPE, SIG_IGN);
+    log_set_verbose(0);
+
+    struct load_client *clients = calloc((size_t)n_clients, sizeof(*clients));
+    if (!clients) return -1;
+    for (int i = 0; i < n_clients; i++)
+    {
+        if (http_init(&clients[i].http_ctx, host, port) != 0)
+        {
+            fprintf(stderr, "Failed to initiate client %d\n", i);
+            return -1;
+        }
+        http_set_callback(clients[i].http_ctx, &clients[i].http_handle, load_callback);
+        http_set_format(clients[i].http_ctx, format);
+        http_set_keep_alive(clients[i].http_ctx, keep_alive);
+        if (encoding != HTTP_ENCODING_IDENTITY && http_set_encoding(clients[i].http_ctx, encoding, 0, 1) != 0)
+        {
+            fprintf(stderr, "Failed to set up compression for client %d\n", i);
+            return -1;
+        }
+        // Short retry steps so a refused connect during ramp-up does not park a client for long
+        tcp_set_retry_policy(clients[i].http_ctx->tcp_ctx, 10, 500, 1000, 1000);
+        snprintf(clients[i].device_id, sizeof(clients[i].device_id), "SSN1-LOAD-%05d", i);
+    }
+
+    struct temp_record records[CODEC_MAX_BATCH];
+    memset(records, 0, sizeof(records));
+    unsigned long sent = 0, failed = 0;
+    double start = load_seconds(), elapsed;
+
+    /* LOAD LOOP: every idle client sends its next batch, every busy one is driven */
+    do
+    {
+        time_t now = time(NULL);
+        for (int i = 0; i < n_clients; i++)
+        {
+            struct load_client *client = &clients[i];
+            if (http_ready(client->http_ctx))
+            {
+                for (int r = 0; r < batch; r++)
+                {
+                    records[r].timestamp      = now - (batch - 1 - r) * 60;
+                    records[r].temperature    = 20.0 + (double)((sent + (unsigned long)r) % 100) / 10.0;
+                    records[r].threshold_flag = 0;
+                }
+                clock_gettime(CLOCK_MONOTONIC, &client->sent);
+                if (http_send_temp_batch(client->http_ctx, client->device_id, records, (size_t)batch) == 0) sent++;
+            }
+            if (http_work(client->http_ctx) < 0) failed++;
+        }
+        elapsed = load_seconds() - start;
+    } while (elapsed < seconds);
+
+    unsigned long responses = 0, rejected = 0;
+    double latency = 0.0, bytes_raw = 0.0, bytes_encoded = 0.0;
+    for (int i = 0; i < n_clients; i++)
+    {
+        responses     += clients[i].responses;
+        rejected      += clients[i].rejected;
+        latency       += clients[i].latency_ms;
+        bytes_raw     += (double)clients[i].http_ctx->bytes_raw;
+        bytes_encoded += (double)clients[i].http_ctx->bytes_encoded;
+        http_dispose(&clients[i].http_ctx);
+    }
+    free(clients);
+
+    fprintf(stderr,
+        "%d %s connection(s), batch %d, %s, %.2f s\n"
+        "  requests:   %lu sent, %lu answered (%lu rejected), %lu failed\n"
+        "  throughput: %.0f req/s, %.0f records/s\n"
+        "  latency:    %.3f ms mean\n"
+        "  body bytes: %.1f MB encoded of %.1f MB (%.1f%%)\n",
+        n_clients, keep_alive ? "keep-alive" : "per-request", batch,
+        format == CODEC_FORMAT_BINARY ? "binary" : "JSON", elapsed,
+        sent, responses, rejected, failed,
+        (double)responses / elapsed, (double)responses * batch / elapsed,
+        responses ? latency / (double)responses : 0.0,
+        bytes_encoded / 1e6, bytes_raw / 1e6, bytes_raw > 0.0 ? 100.0 * bytes_encoded / bytes_raw : 0.0);
+    return 0;
+}
@@ -0,0 +1,167 @@
+#include "ingest.h"
+#include "log.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/resource.h>
+
+static volatile sig_atomic_t ingest_quit = 0;
+
+/**
+ * @Brief: SIGINT/SIGTERM handler asking the main loop to stop.
+ * @Param: sig The signal number.
+ * @Return: void
+ */
+static void ingest_on_signal(int sig)
+{
+    (void)sig;
+    ingest_quit = 1;
+}
+
+/**
+ * @Brief: Prints every row of a column file.
+ * @Param: path Path to the .col file.
+ * @Return: 0 on success, -1 on a missing or malformed file.
+ */
+static int ingest_dump(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        fprintf(stderr, "Failed to open %s\n", path);
+        return -1;
+    }
+
+    struct ingest_col_header header;
+    unsigned long total = 0;
+    printf("timestamp,temperature,threshold_flag,min,max,stddev,p95\n");
+    while (fread(&header, sizeof(header), 1, file) == 1)
+    {
+        if (header.magic != INGEST_COL_MAGIC || header.rows > INGEST_BLOCK_ROWS)
+        {
+            fprintf(stderr, "%s: bad block after %lu rows\n", path, total);
+            fclose(file);
+            return -1;
+        }
+        uint32_t rows = header.rows;
+        int64_t ts[INGEST_BLOCK_ROWS];
+        double  temp[INGEST_BLOCK_ROWS];
+        float   agg[4][INGEST_BLOCK_ROWS];
+        uint8_t flag[INGEST_BLOCK_ROWS];
+        if (fread(ts, sizeof(ts[0]), rows, file) != rows ||
+            fread(temp, sizeof(temp[0]), rows, file) != rows ||
+            fread(agg[0], sizeof(float), rows, file) != rows ||
+            fread(agg[1], sizeof(float), rows, file) != rows ||
+            fread(agg[2], sizeof(float), rows, file) != rows ||
+            fread(agg[3], sizeof(float), rows, file) != rows ||
+            fread(flag, sizeof(flag[0]), rows, file) != rows)
+        {
+            fprintf(stderr, "%s: truncated block after %lu rows\n", path, total);
+            fclose(file);
+            return -1;
+        }
+        for (uint32_t i = 0; i < rows; i++)
+        {
+            printf("%lld,%.2f,%u,%.2f,%.2f,%.3f,%.2f\n", (long long)ts[i], temp[i], flag[i],
+                   agg[0][i], agg[1][i], agg[2][i], agg[3][i]);
+        }
+        total += rows;
+    }
+    fclose(file);
+    fprintf(stderr, "%lu rows\n", total);
+    return 0;
+}
+
+/**
+ * @Brief: Prints usage information.
+ * @Param: prog The program name.
+ * @Return: void
+ */
+static void ingest_usage(const char *prog)
+{
+    fprintf(stderr,
+        "### SSN-1 ingest server ###\n"
+        "Accepts POST /post uploads (JSON or binary, single or batch) on keep-alive connections\n"
+        "and appends the records to one columnar file per device.\n"
+        "\n"
+        "Usage: %s [-b bind address] [-p port] [-w workers] [-d dir] [-q]\n"
+        "       %s -x <file.col>   print the rows of a column file as CSV\n"
+        "Example: %s -p 8080 -w 4 -d ingest-data\n", prog, prog, prog);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *bind_host = "127.0.0.1";
+    const char *port      = "8080";
+    const char *dir       = "ingest-data";
+    int n_workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int quiet = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "b:p:w:d:x:q")) != -1)
+    {
+        switch (opt)
+        {
+            case 'b': bind_host = optarg;       break;
+            case 'p': port      = optarg;       break;
+            case 'w': n_workers = atoi(optarg); break;
+            case 'd': dir       = optarg;       break;
+            case 'x': return ingest_dump(optarg);
+            case 'q': quiet     = 1;            break;
+            default:
+                ingest_usage(argv[0]);
+                return -1;
+        }
+    }
+    if (n_workers <= 0) n_workers = 1;
+
+    // Every connection is a descriptor; allow as many as the hard limit permits
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    log_set_verbose(0);
+    struct ingest *ingest;
+    if (ingest_init(&ingest, bind_host, port, dir, n_workers) != 0 || ingest_start(ingest) != 0)
+    {
+        fprintf(stderr, "Failed to start ingest server\n");
+        return -1;
+    }
+    fprintf(stderr, "Listening on %s:%u with %d worker(s), writing to %s/\n", bind_host, ingest->port, n_workers, dir);
+
+    signal(SIGINT, ingest_on_signal);
+    signal(SIGTERM, ingest_on_signal);
+    signal(SIGPIPE, SIG_IGN);
+
+    struct ingest_stats prev = { 0 }, now;
+    struct timespec second = { 1, 0 };
+    while (!ingest_quit)
+    {
+        nanosleep(&second, NULL);
+        ingest_stats(ingest, &now);
+        if (!quiet)
+        {
+            fprintf(stderr, "%llu conn | %llu req/s | %llu records/s | %.1f MB/s | %llu errors | %llu blocks\n",
+                    (unsigned long long)now.connections,
+                    (unsigned long long)(now.requests - prev.requests),
+                    (unsigned long long)(now.records - prev.records),
+                    (double)(now.bytes - prev.bytes) / 1e6,
+                    (unsigned long long)now.errors, (unsigned long long)now.blocks);
+        }
+        prev = now;
+    }
+
+    ingest_stop(ingest);
+    ingest_stats(ingest, &now);
+    fprintf(stderr, "Stopped: %llu connections, %llu requests, %llu records, %llu blocks written\n",
+            (unsigned long long)now.accepted, (unsigned long long)now.requests,
+            (unsigned long long)now.records, (unsigned long long)now.blocks);
+    ingest_dispose(&ingest);
+    return 0;
+}
@@ -0,0 +1,140 @@
+#include "shm.h"
+#include "ssn-1.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+/**
+ * @Brief: Returns CLOCK_MONOTONIC time in seconds.
+ * @Return: Seconds as a double.
+ */
+static double shm_read_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/**
+ * @Brief: Prints one published record.
+ * @Param: device_id The device the record belongs to.
+ * @Param: record The record to print.
+ * @Return: void
+ */
+static void shm_read_print(const char *device_id, const struct shm_record *record)
+{
+    printf("%s: reading %.2f°C, average %.2f°C, th_flag %d, alert %d, update #%llu at %lld\n",
+           device_id, record->temp_read, record->temp_average, record->th_flag,
+           record->alert_active, (unsigned long long)record->updates, (long long)record->timestamp);
+}
+
+/**
+ * @Brief: Measures reader throughput against a forked writer publishing at a fixed rate.
+ * @Param: rate_hz Writer update rate.
+ * @Param: seconds Duration of the measurement.
+ * @Return: 0 on success, -1 on failure.
+ */
+static int shm_read_bench(int rate_hz, double seconds)
+{
+    const char *device_id = "SSN1-SHM-BENCH";
+    struct shm_writer *writer;
+    if (shm_writer_open(&writer, device_id) != 0) return -1;
+
+    pid_t pid = fork();
+    if (pid < 0) return -1;
+    if (pid == 0)
+    {
+        // Writer process: publish at rate_hz until killed
+        struct shm_record record = { 0 };
+        struct timespec period = { 0, 1000000000L / rate_hz };
+        for (;;)
+        {
+            record.timestamp++;
+            record.temp_read    = (double)(record.timestamp % 100);
+            record.temp_average = record.temp_read;
+            shm_publish(writer, &record);
+            nanosleep(&period, NULL);
+        }
+    }
+
+    struct shm_reader *reader;
+    if (shm_reader_open(&reader, device_id) != 0)
+    {
+        kill(pid, SIGKILL);
+        return -1;
+    }
+
+    struct shm_record record;
+    unsigned long reads = 0, torn = 0;
+    double start = shm_read_seconds(), elapsed;
+    do
+    {
+        for (int i = 0; i < 4096; i++)
+        {
+            if (shm_read(reader, &record) == 0)
+            {
+                // Writer keeps temp_read == temp_average; a mismatch would be a torn copy
+                if (record.temp_read != record.temp_average) torn++;
+                reads++;
+            }
+        }
+        elapsed = shm_read_seconds() - start;
+    } while (elapsed < seconds);
+
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+
+    printf("Writer at %d Hz, %llu updates seen\n"
+           "  reads:      %lu in %.2f s (%.1f M reads/s)\n"
+           "  retries:    %llu\n"
+           "  torn reads: %lu\n",
+           rate_hz, (unsigned long long)record.updates, reads, elapsed, reads / elapsed / 1e6,
+           (unsigned long long)reader->retries, torn);
+
+    shm_reader_close(&reader);
+    shm_writer_close(&writer);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int    rate_hz = 0;
+    double seconds = 2.0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "b:t:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'b': rate_hz = atoi(optarg);         break;
+            case 't': seconds = strtod(optarg, NULL); break;
+            default:
+                printf("Usage: %s [device id]        print the latest published values\n"
+                       "       %s -b <rate Hz> [-t s]  benchmark readers against a writer\n", argv[0], argv[0]);
+                return -1;
+        }
+    }
+
+    if (rate_hz > 0)
+    {
+        return shm_read_bench(rate_hz, seconds);
+    }
+
+    const char *device_id = optind < argc ? argv[optind] : SSN1_DEVICE_ID;
+    struct shm_reader *reader;
+    if (shm_reader_open(&reader, device_id) != 0)
+    {
+        printf("No SSN-1 segment published for %s\n", device_id);
+        return -1;
+    }
+
+    struct shm_record record;
+    int rv = shm_read(reader, &record);
+    if (rv == 0) shm_read_print(device_id, &record);
+    shm_reader_close(&reader);
+    return rv;
+}
@@ -0,0 +1,182 @@
+#include "stats.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <time.h>
+
+#define BENCH_WINDOW_MAX 3600
+
+typedef enum
+{
+    BENCH_STEADY,   // Slow random walk plus sensor noise
+    BENCH_SPIKES,   // As steady, with rare large outliers (door opened, sensor glitch)
+    BENCH_STEP      // As steady, with a setpoint change somewhere in the window
+} bench_profile_t;
+
+static const char *bench_profile_names[] = { "steady", "spikes", "step" };
+
+/**
+ * @Brief: Returns the process CPU time in seconds.
+ * @Return: Seconds as a double.
+ */
+static double bench_cpu_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/**
+ * @Brief: Returns a uniform value in [-0.5, 0.5].
+ * @Param: seed Generator state.
+ * @Return: The value.
+ */
+static double bench_uniform(unsigned int *seed)
+{
+    return (double)rand_r(seed) / RAND_MAX - 0.5;
+}
+
+/**
+ * @Brief: Fills one window of 1 Hz readings following a profile.
+ * @Param: out Destination array.
+ * @Param: count Number of readings.
+ * @Param: profile Signal shape.
+ * @Param: seed Generator state.
+ * @Return: void
+ */
+static void bench_fill(double *out, size_t count, bench_profile_t profile, unsigned int *seed)
+{
+    double level = 21.0 + bench_uniform(seed) * 4.0;
+    size_t step_at = count / 4 + (size_t)rand_r(seed) % (count / 2 + 1);
+    double step = (bench_uniform(seed) < 0.0 ? -1.0 : 1.0) * 3.0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        level += bench_uniform(seed) * 0.02;
+        double x = level + bench_uniform(seed) * 0.3;
+        if (profile == BENCH_SPIKES && rand_r(seed) % 100 == 0) x += 15.0 + bench_uniform(seed) * 10.0;
+        if (profile == BENCH_STEP && i >= step_at) x += step;
+        out[i] = x;
+    }
+}
+
+/**
+ * @Brief: qsort comparator for doubles.
+ */
+static int bench_cmp(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @Brief: Exact quantile of sorted data, interpolating linearly between order statistics.
+ * @Param: sorted The sorted window.
+ * @Param: count Number of values.
+ * @Param: p The quantile (0..1).
+ * @Return: The quantile.
+ */
+static double bench_exact(const double *sorted, size_t count, double p)
+{
+    double pos = p * (double)(count - 1);
+    size_t lo = (size_t)pos;
+    if (lo + 1 >= count) return sorted[count - 1];
+    return sorted[lo] + (pos - (double)lo) * (sorted[lo + 1] - sorted[lo]);
+}
+
+/**
+ * @Brief: Prints usage information.
+ * @Param: prog The program name.
+ * @Return: void
+ */
+static void bench_usage(const char *prog)
+{
+    fprintf(stderr,
+        "### SSN-1 window statistics benchmark ###\n"
+        "Feeds realistic windows of 1 Hz readings through the streaming aggregates (Welford + P²)\n"
+        "and compares p50/p95 against exact quantiles from a sorted copy of the same window.\n"
+        "Reports the mean and worst absolute error in °C and the throughput of both methods.\n"
+        "\n"
+        "Usage: %s [-n samples per case] [-s seed]\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+    long samples = 2000000;
+    unsigned int seed = 1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': samples = atol(optarg);                       break;
+            case 's': seed = (unsigned int)strtoul(optarg, NULL, 10); break;
+            default:
+                bench_usage(argv[0]);
+                return -1;
+        }
+    }
+    if (samples <= 0)
+    {
+        bench_usage(argv[0]);
+        return -1;
+    }
+
+    static const size_t windows[] = { 60, 600, 3600 };
+    static double data[BENCH_WINDOW_MAX];
+    static double sorted[BENCH_WINDOW_MAX];
+
+    printf("%-7s %6s  %9s %9s  %9s %9s  %12s %12s\n",
+           "profile", "window", "p50 mean", "p50 max", "p95 mean", "p95 max", "P2 Msample/s", "sort Msample/s");
+
+    for (int profile = BENCH_STEADY; profile <= BENCH_STEP; profile++)
+    {
+        for (size_t w = 0; w < sizeof(windows) / sizeof(windows[0]); w++)
+        {
+            size_t count = windows[w];
+            long n_windows = samples / (long)count;
+            if (n_windows < 1) n_windows = 1;
+
+            double err50 = 0.0, err95 = 0.0, max50 = 0.0, max95 = 0.0;
+            double cpu_p2 = 0.0, cpu_exact = 0.0;
+            unsigned int rng = seed;
+            struct stats_window window;
+            struct stats_summary summary;
+
+            for (long k = 0; k < n_windows; k++)
+            {
+                bench_fill(data, count, (bench_profile_t)profile, &rng);
+
+                // Both methods are timed over the whole window, including the final summary
+                double t0 = bench_cpu_seconds();
+                stats_reset(&window);
+                for (size_t i = 0; i < count; i++) stats_add(&window, data[i]);
+                stats_summarize(&window, &summary);
+                double t1 = bench_cpu_seconds();
+                memcpy(sorted, data, count * sizeof(double));
+                qsort(sorted, count, sizeof(double), bench_cmp);
+                double p50 = bench_exact(sorted, count, 0.50);
+                double p95 = bench_exact(sorted, count, 0.95);
+                double t2 = bench_cpu_seconds();
+                cpu_p2    += t1 - t0;
+                cpu_exact += t2 - t1;
+
+                double e50 = fabs(summary.p50 - p50), e95 = fabs(summary.p95 - p95);
+                err50 += e50;
+                err95 += e95;
+                if (e50 > max50) max50 = e50;
+                if (e95 > max95) max95 = e95;
+            }
+
+            double total = (double)n_windows * (double)count;
+            printf("%-7s %6zu  %9.4f %9.4f  %9.4f %9.4f  %12.1f %14.1f\n",
+                   bench_profile_names[profile], count,
+                   err50 / n_windows, max50, err95 / n_windows, max95,
+                   total / cpu_p2 / 1e6, total / cpu_exact / 1e6);
+        }
+    }
+    return 0;
+}